@@ -54,14 +54,18 @@
 
 #include <SDL.h>
 
+#include <cdogs/actor_grid.h>
 #include <cdogs/actors.h>
 #include <cdogs/ai.h>
 #include <cdogs/blit.h>
 #include <cdogs/campaigns.h>
+#include <cdogs/char_sprite_cache.h>
+#include <cdogs/collision.h>
 #include <cdogs/config.h>
 #include <cdogs/draw.h>
 #include <cdogs/events.h>
 #include <cdogs/files.h>
+#include <cdogs/floor_layer.h>
 #include <cdogs/gamedata.h>
 #include <cdogs/grafx.h>
 #include <cdogs/hiscores.h>
@@ -76,6 +80,8 @@
 #include <cdogs/pics.h>
 #include <cdogs/sounds.h>
 #include <cdogs/text.h>
+#include <cdogs/tile_cache.h>
+#include <cdogs/tile_item_index.h>
 #include <cdogs/triggers.h>
 #include <cdogs/utils.h>
 
@@ -137,13 +143,13 @@ void DrawObjectiveInfo(int idx, int x, int y, struct Mission *mission)
 		if (table)
 		{
 			DrawTTPic(
-				x + pic.dx, y + pic.dy,
+				&gGraphicsDevice, x + pic.dx, y + pic.dy,
 				PicManagerGetOldPic(&gPicManager, pic.picIndex), table);
 		}
 		else
 		{
 			DrawTPic(
-				x + pic.dx, y + pic.dy,
+				&gGraphicsDevice, x + pic.dx, y + pic.dy,
 				PicManagerGetOldPic(&gPicManager, pic.picIndex));
 		}
 	}
@@ -1237,6 +1243,8 @@ int main(int argc, char *argv[])
 	BulletInitialize();
 	WeaponInitialize();
 	PlayerDataInitialize();
+	CharSpriteCacheInit(
+		&gCharSpriteCache, gConfig.Graphics.CharacterCacheSize * 1024);
 	GraphicsInit(&gGraphicsDevice);
 	GraphicsInitialize(
 		&gGraphicsDevice, &gConfig.Graphics, gPicManager.palette,
@@ -1265,6 +1273,12 @@ int main(int argc, char *argv[])
 	InputTerminate(&gInputDevices);
 	GraphicsTerminate(&gGraphicsDevice);
 
+	FloorLayerTerminate(&gFloorLayer);
+	TileCacheClear(&gTileCache);
+	TileItemIndexTerminate();
+	ActorGridTerminate();
+	CollisionBatchTerminate();
+	CharSpriteCacheTerminate(&gCharSpriteCache);
 	PicManagerTerminate(&gPicManager);
 	AutosaveSave(&gAutosave, GetConfigFilePath(AUTOSAVE_FILE));
 	ConfigSave(&gConfig, GetConfigFilePath(CONFIG_FILE));
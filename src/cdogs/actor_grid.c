@@ -0,0 +1,218 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "actor_grid.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define CELL_WIDTH	(ACTOR_GRID_CELL_TILES * TILE_WIDTH * 256)
+#define CELL_HEIGHT	(ACTOR_GRID_CELL_TILES * TILE_HEIGHT * 256)
+
+static ActorGridCell sCells[2][ACTOR_GRID_HEIGHT][ACTOR_GRID_WIDTH];
+
+
+void ActorGridTerminate(void)
+{
+	int i, x, y;
+	for (i = 0; i < 2; i++)
+	{
+		for (y = 0; y < ACTOR_GRID_HEIGHT; y++)
+		{
+			for (x = 0; x < ACTOR_GRID_WIDTH; x++)
+			{
+				CFREE(sCells[i][y][x].entries);
+			}
+		}
+	}
+	memset(sCells, 0, sizeof sCells);
+}
+
+void ActorGridClear(void)
+{
+	int i, x, y;
+	for (i = 0; i < 2; i++)
+	{
+		for (y = 0; y < ACTOR_GRID_HEIGHT; y++)
+		{
+			for (x = 0; x < ACTOR_GRID_WIDTH; x++)
+			{
+				sCells[i][y][x].count = 0;
+			}
+		}
+	}
+}
+
+CollisionTeam ActorGridTeam(const TActor *a)
+{
+	if (a->pData || (a->flags & FLAGS_GOOD_GUY))
+	{
+		return COLLISIONTEAM_GOOD;
+	}
+	return COLLISIONTEAM_BAD;
+}
+
+static int TeamIndex(CollisionTeam team)
+{
+	return team == COLLISIONTEAM_GOOD ? 0 : 1;
+}
+
+static ActorGridCell *GetCell(CollisionTeam team, int x, int y)
+{
+	return &sCells[TeamIndex(team)]
+		[CLAMP(y / CELL_HEIGHT, 0, ACTOR_GRID_HEIGHT - 1)]
+		[CLAMP(x / CELL_WIDTH, 0, ACTOR_GRID_WIDTH - 1)];
+}
+
+// Whether the actor is in the grid, as opposed to never added, removed, or
+// forgotten by a clear
+static int IsInGrid(const TActor *a)
+{
+	return
+		a->gridCell != NULL &&
+		a->gridSlot < a->gridCell->count &&
+		a->gridCell->entries[a->gridSlot].actor == a;
+}
+
+void ActorGridMove(TActor *a)
+{
+	ActorGridCell *cell = GetCell(ActorGridTeam(a), a->x, a->y);
+	ActorGridEntry *e;
+	if (!IsInGrid(a) || a->gridCell != cell)
+	{
+		ActorGridRemove(a);
+		if (cell->count == cell->size)
+		{
+			cell->size = cell->size == 0 ? 4 : cell->size * 2;
+			CREALLOC(cell->entries, cell->size * sizeof *cell->entries);
+		}
+		a->gridCell = cell;
+		a->gridSlot = cell->count;
+		cell->count++;
+	}
+	e = &cell->entries[a->gridSlot];
+	e->actor = a;
+	e->x = a->x;
+	e->y = a->y;
+	e->serial = a->serial;
+}
+
+void ActorGridRemove(TActor *a)
+{
+	ActorGridCell *cell = a->gridCell;
+	if (IsInGrid(a))
+	{
+		cell->count--;
+		if (a->gridSlot != cell->count)
+		{
+			// Move the last entry into the hole
+			ActorGridEntry *e = &cell->entries[a->gridSlot];
+			*e = cell->entries[cell->count];
+			e->actor->gridSlot = a->gridSlot;
+		}
+	}
+	a->gridCell = NULL;
+	a->gridSlot = 0;
+}
+
+TActor *ActorGridGetClosest(
+	Vec2i pos, CollisionTeam team, int excludeFlags, int playersOnly,
+	int maxRadius)
+{
+	ActorGridCell (*cells)[ACTOR_GRID_WIDTH] = sCells[TeamIndex(team)];
+	// Rings can only be cut short if pos is in the cell it is searched from
+	const int isInGrid =
+		pos.x >= 0 && pos.x < ACTOR_GRID_WIDTH * CELL_WIDTH &&
+		pos.y >= 0 && pos.y < ACTOR_GRID_HEIGHT * CELL_HEIGHT;
+	const int cx = CLAMP(pos.x / CELL_WIDTH, 0, ACTOR_GRID_WIDTH - 1);
+	const int cy = CLAMP(pos.y / CELL_HEIGHT, 0, ACTOR_GRID_HEIGHT - 1);
+	const int maxRing = MAX(ACTOR_GRID_WIDTH, ACTOR_GRID_HEIGHT);
+	TActor *closest = NULL;
+	int minDistance = 0;
+	int minSerial = 0;
+	int r;
+	for (r = 0; r <= maxRing; r++)
+	{
+		int y;
+		if (isInGrid && r > 0)
+		{
+			// Everything in this ring and beyond is at least this far away
+			const int bound = (r - 1) * MIN(CELL_WIDTH, CELL_HEIGHT);
+			if ((closest && bound > minDistance) ||
+				(maxRadius >= 0 && bound > maxRadius))
+			{
+				break;
+			}
+		}
+		for (y = MAX(cy - r, 0); y <= MIN(cy + r, ACTOR_GRID_HEIGHT - 1); y++)
+		{
+			// Inner rows of the ring only have their two ends
+			const int isEdgeRow = y == cy - r || y == cy + r;
+			const int step = (isEdgeRow || r == 0) ? 1 : 2 * r;
+			int x;
+			for (x = cx - r; x <= cx + r; x += step)
+			{
+				const ActorGridCell *cell;
+				int i;
+				if (x < 0 || x >= ACTOR_GRID_WIDTH)
+				{
+					continue;
+				}
+				cell = &cells[y][x];
+				for (i = 0; i < cell->count; i++)
+				{
+					const ActorGridEntry *e = &cell->entries[i];
+					const int distance =
+						CHEBYSHEV_DISTANCE(pos.x, pos.y, e->x, e->y);
+					if (maxRadius >= 0 && distance > maxRadius)
+					{
+						continue;
+					}
+					if (closest &&
+						(distance > minDistance ||
+						(distance == minDistance && e->serial < minSerial)))
+					{
+						continue;
+					}
+					if ((e->actor->flags & excludeFlags) ||
+						(playersOnly &&
+						(e->actor->pData == NULL || e->actor->dead)))
+					{
+						continue;
+					}
+					closest = e->actor;
+					minDistance = distance;
+					minSerial = e->serial;
+				}
+			}
+		}
+	}
+	return closest;
+}
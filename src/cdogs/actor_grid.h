@@ -0,0 +1,84 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __ACTOR_GRID
+#define __ACTOR_GRID
+
+#include "actors.h"
+#include "collision.h"
+
+// Coarse grid of actors, for nearest enemy and nearest player queries
+// Actors are bucketed by team: good guys and players on one side, bad guys
+// on the other. Each cell keeps a dense array of its actors along with
+// their positions, which MoveActor keeps current.
+// Queries search rings of cells outwards from a point and stop once no
+// further cell can hold anything closer.
+
+#define ACTOR_GRID_CELL_TILES 8
+#define ACTOR_GRID_WIDTH	(XMAX / ACTOR_GRID_CELL_TILES)
+#define ACTOR_GRID_HEIGHT	(YMAX / ACTOR_GRID_CELL_TILES)
+
+typedef struct
+{
+	TActor *actor;
+	int x, y;
+	// Order the actor was added, to break ties the way a search of the
+	// actor list would: newest first
+	int serial;
+} ActorGridEntry;
+
+struct ActorGridCell
+{
+	ActorGridEntry *entries;
+	int count;
+	int size;
+};
+typedef struct ActorGridCell ActorGridCell;
+
+void ActorGridTerminate(void);
+// Forget every actor, for when actors are discarded without being removed
+void ActorGridClear(void);
+
+// Add or move an actor to its current position
+void ActorGridMove(TActor *a);
+void ActorGridRemove(TActor *a);
+
+// The team an actor is bucketed in: COLLISIONTEAM_GOOD for players and good
+// guys, otherwise COLLISIONTEAM_BAD
+CollisionTeam ActorGridTeam(const TActor *a);
+
+// Closest actor of a team to pos, by Chebyshev distance in full coordinates
+// Actors with any of excludeFlags are skipped; if playersOnly, only living
+// players are considered.
+// maxRadius is the distance cut-off; negative for no cut-off
+// Returns NULL if there are none
+TActor *ActorGridGetClosest(
+	Vec2i pos, CollisionTeam team, int excludeFlags, int playersOnly,
+	int maxRadius);
+
+#endif
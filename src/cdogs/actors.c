@@ -53,6 +53,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "actor_grid.h"
+#include "char_sprite_cache.h"
 #include "character.h"
 #include "collision.h"
 #include "config.h"
@@ -62,10 +64,12 @@
 #include "defs.h"
 #include "objs.h"
 #include "gamedata.h"
+#include "palette.h"
 #include "triggers.h"
 #include "hiscores.h"
 #include "mission.h"
 #include "game.h"
+#include "tile_item_index.h"
 #include "utils.h"
 
 #define SOUND_LOCK_FOOTSTEP 4
@@ -85,6 +89,7 @@ TranslationTable tablePurple;
 
 
 static TActor *actorList = NULL;
+static int sActorSerial = 0;
 
 
 static int transitionTable[STATE_COUNT] = {
@@ -123,16 +128,21 @@ int GetNumPlayersAlive(void)
 }
 
 TActor *GetFirstAlivePlayer(void)
+{
+	int i = GetFirstAlivePlayerIndex();
+	return i >= 0 ? gPlayers[i] : NULL;
+}
+int GetFirstAlivePlayerIndex(void)
 {
 	int i;
 	for (i = 0; i < MAX_PLAYERS; i++)
 	{
 		if (IsPlayerAlive(i))
 		{
-			return gPlayers[i];
+			return i;
 		}
 	}
-	return NULL;
+	return -1;
 }
 
 int IsPlayerAlive(int player)
@@ -177,7 +187,7 @@ void PlayersGetBoundingRectangle(
 	}
 }
 
-void DrawCharacter(int x, int y, TActor * actor)
+void DrawCharacter(GraphicsDevice *device, int x, int y, TActor * actor)
 {
 	direction_e dir = actor->direction;
 	direction_e headDir = dir;
@@ -194,6 +204,7 @@ void DrawCharacter(int x, int y, TActor * actor)
 
 	TOffsetPic body, head, gun;
 	TOffsetPic pic1, pic2, pic3;
+	CharSpriteKey key;
 
 	int transparent = (actor->flags & FLAGS_SEETHROUGH) != 0;
 
@@ -234,23 +245,19 @@ void DrawCharacter(int x, int y, TActor * actor)
 			if (transparent)
 			{
 				DrawBTPic(
-					x + body.dx, y + body.dy,
+					device, x + body.dx, y + body.dy,
 					PicManagerGetOldPic(&gPicManager, body.picIndex), tint);
 			}
 			else
 			{
 				DrawTTPic(
-					x + body.dx, y + body.dy,
+					device, x + body.dx, y + body.dy,
 					PicManagerGetOldPic(&gPicManager, body.picIndex), table);
 			}
 		}
 		return;
 	}
 
-	actor->flags |= FLAGS_VISIBLE;
-	// TODO: this means any character wakes up when visible
-	actor->flags &= ~FLAGS_SLEEPING;
-
 	if (state == STATE_IDLELEFT)
 		headDir = (dir + 7) % 8;
 	else if (state == STATE_IDLERIGHT)
@@ -281,8 +288,11 @@ void DrawCharacter(int x, int y, TActor * actor)
 		    cGunHandOffset[b][dir].dy +
 		    cGunPics[g][dir][gunState].dy;
 		gun.picIndex = cGunPics[g][dir][gunState].picIndex;
-	} else
+	} else {
+		gun.dx = 0;
+		gun.dy = 0;
 		gun.picIndex = -1;
+	}
 
 	switch (dir)
 	{
@@ -318,49 +328,44 @@ void DrawCharacter(int x, int y, TActor * actor)
 		if (pic1.picIndex >= 0)
 		{
 			DrawBTPic(
-				x + pic1.dx, y + pic1.dy,
+				device, x + pic1.dx, y + pic1.dy,
 				PicManagerGetOldPic(&gPicManager, pic1.picIndex), tint);
 		}
 		if (pic2.picIndex >= 0)
 		{
 			DrawBTPic(
-				x + pic2.dx, y + pic2.dy,
+				device, x + pic2.dx, y + pic2.dy,
 				PicManagerGetOldPic(&gPicManager, pic2.picIndex), tint);
 		}
 		if (pic3.picIndex >= 0)
 		{
 			DrawBTPic(
-				x + pic3.dx, y + pic3.dy,
+				device, x + pic3.dx, y + pic3.dy,
 				PicManagerGetOldPic(&gPicManager, pic3.picIndex), tint);
 		}
 	}
 	else
 	{
-		DrawShadow(&gGraphicsDevice, Vec2iNew(x, y), Vec2iNew(8, 6));
-		if (pic1.picIndex >= 0)
-		{
-			Blit(
-				x + pic1.dx, y + pic1.dy,
-				PicManagerGetOldPic(&gPicManager, pic1.picIndex),
-				table, BLIT_TRANSPARENT);
-		}
-		if (pic2.picIndex >= 0)
-		{
-			Blit(
-				x + pic2.dx, y + pic2.dy,
-				PicManagerGetOldPic(&gPicManager, pic2.picIndex),
-				table, BLIT_TRANSPARENT);
-		}
-		if (pic3.picIndex >= 0)
-		{
-			Blit(
-				x + pic3.dx, y + pic3.dy,
-				PicManagerGetOldPic(&gPicManager, pic3.picIndex),
-				table, BLIT_TRANSPARENT);
-		}
+		DrawShadow(device, Vec2iNew(x, y), Vec2iNew(8, 6));
+		key.table = table;
+		key.layers[0] = pic1;
+		key.layers[1] = pic2;
+		key.layers[2] = pic3;
+		CharSpriteCacheDraw(&gCharSpriteCache, device, &key, Vec2iNew(x, y));
 	}
 }
 
+void ActorSetSeen(TActor *actor)
+{
+	if (actor->dead)
+	{
+		return;
+	}
+	actor->flags |= FLAGS_VISIBLE;
+	// TODO: this means any character wakes up when visible
+	actor->flags &= ~FLAGS_SLEEPING;
+}
+
 
 TActor *AddActor(Character *c, struct PlayerData *p)
 {
@@ -377,6 +382,7 @@ TActor *AddActor(Character *c, struct PlayerData *p)
 	actor->tileItem.h = 5;
 	actor->tileItem.flags = TILEITEM_IMPASSABLE | TILEITEM_CAN_BE_SHOT;
 	actor->tileItem.actor = actor;
+	actor->serial = sActorSerial++;
 	actor->next = actorList;
 	actorList = actor;
 	actor->flags = FLAGS_SLEEPING | c->flags;
@@ -398,6 +404,7 @@ TActor *RemoveActor(TActor * actor)
 		int i;
 		*h = actor->next;
 		RemoveTileItem(&actor->tileItem);
+		ActorGridRemove(actor);
 		for (i = 0; i < MAX_PLAYERS; i++)
 		{
 			if (actor == gPlayers[i])
@@ -450,6 +457,7 @@ void UpdateActorState(TActor * actor, int ticks)
 		actor->dead++;
 		actor->stateCounter = 4;
 		actor->tileItem.flags = 0;
+		TileItemIndexUpdate(&actor->tileItem);
 		return;
 	}
 
@@ -585,6 +593,8 @@ int MoveActor(TActor * actor, int x, int y)
 			    && (otherCharacter->flags & FLAGS_PRISONER) !=
 			    0) {
 				otherCharacter->flags &= ~FLAGS_PRISONER;
+				// Rescued prisoners now have a collision team
+				TileItemIndexUpdate(&otherCharacter->tileItem);
 				CheckMissionObjective(otherCharacter->
 						      tileItem.flags);
 			}
@@ -652,6 +662,7 @@ int MoveActor(TActor * actor, int x, int y)
 	actor->x = x;
 	actor->y = y;
 	MoveTileItem(&actor->tileItem, x >> 8, y >> 8);
+	ActorGridMove(actor);
 	return 1;
 }
 
@@ -968,6 +979,9 @@ void KillAllActors(void)
 		actorList = actorList->next;
 		RemoveActor(actor);
 	}
+	// The actors are no longer in the actor list, so RemoveActor leaves them
+	// in the grid
+	ActorGridClear();
 }
 
 unsigned char BestMatch(const TPalette palette, int r, int g, int b)
@@ -1047,6 +1061,7 @@ void BuildTranslationTables(const TPalette palette)
 			(200 * palette[i].g) / 256,
 			(200 * palette[i].b) / 256);
 	}
+	PaletteInvalidateLUTs();
 }
 
 int ActorIsImmune(TActor *actor, special_damage_e damage)
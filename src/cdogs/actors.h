@@ -130,6 +130,11 @@ struct Actor {
 	int delay;
 
 	TTileItem tileItem;
+	// Where the actor is in the actor grid
+	struct ActorGridCell *gridCell;
+	int gridSlot;
+	// Order of creation; later actors have higher serials
+	int serial;
 	struct Actor *next;
 };
 typedef struct Actor TActor;
@@ -147,11 +152,14 @@ extern TranslationTable tablePurple;
 
 int GetNumPlayersAlive(void);
 TActor *GetFirstAlivePlayer(void);
+int GetFirstAlivePlayerIndex(void);
 int IsPlayerAlive(int player);
 Vec2i PlayersGetMidpoint(TActor *players[MAX_PLAYERS]);
 void PlayersGetBoundingRectangle(
 	TActor *players[MAX_PLAYERS], Vec2i *min, Vec2i *max);
-void DrawCharacter(int x, int y, TActor * actor);
+void DrawCharacter(GraphicsDevice *device, int x, int y, TActor * actor);
+// Mark a character in a player's line of sight as visible, and wake it up
+void ActorSetSeen(TActor *actor);
 
 void SetStateForActor(TActor * actor, int state);
 void UpdateActorState(TActor * actor, int ticks);
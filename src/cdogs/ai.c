@@ -51,6 +51,7 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#include "actor_grid.h"
 #include "collision.h"
 #include "config.h"
 #include "defs.h"
@@ -111,67 +112,17 @@ static int IsFacingPlayer(TActor *actor, direction_e d)
 
 TActor *GetClosestEnemy(Vec2i from, int flags, int isPlayer)
 {
-	// Search all the actors and find the closest one that is an enemy
-	TActor *a;
-	TActor *closestEnemy = NULL;
-	int minDistance = -1;
-	for (a = ActorList(); a; a = a->next)
-	{
-		int isEnemy = 0;
-		int distance;
-		// Never target invulnerables or victims
-		if (a->flags & (FLAGS_INVULNERABLE | FLAGS_VICTIM))
-		{
-			continue;
-		}
-		if (a->pData || (a->flags & FLAGS_GOOD_GUY))
-		{
-			// target is good guy / player, check if we are bad
-			if (!isPlayer && !(flags & FLAGS_GOOD_GUY))
-			{
-				isEnemy = 1;
-			}
-		}
-		else
-		{
-			// target is bad guy, check if we are good
-			if (isPlayer || (flags & FLAGS_GOOD_GUY))
-			{
-				isEnemy = 1;
-			}
-		}
-		if (isEnemy)
-		{
-			distance = CHEBYSHEV_DISTANCE(from.x, from.y, a->x, a->y);
-			if (!closestEnemy || distance < minDistance)
-			{
-				minDistance = distance;
-				closestEnemy = a;
-			}
-		}
-	}
-	return closestEnemy;
+	// Players and good guys are the enemies of bad guys, and vice versa
+	// Never target invulnerables or victims
+	const int isGood = isPlayer || (flags & FLAGS_GOOD_GUY);
+	return ActorGridGetClosest(
+		from, isGood ? COLLISIONTEAM_BAD : COLLISIONTEAM_GOOD,
+		FLAGS_INVULNERABLE | FLAGS_VICTIM, 0, -1);
 }
 
 static TActor *GetClosestPlayer(Vec2i pos)
 {
-	int i;
-	int minDistance = -1;
-	TActor *closestPlayer = NULL;
-	for (i = 0; i < MAX_PLAYERS; i++)
-	{
-		if (IsPlayerAlive(i))
-		{
-			TActor *p = gPlayers[i];
-			int distance = CHEBYSHEV_DISTANCE(pos.x, pos.y, p->x, p->y);
-			if (!closestPlayer || distance < minDistance)
-			{
-				closestPlayer = p;
-				minDistance = distance;
-			}
-		}
-	}
-	return closestPlayer;
+	return ActorGridGetClosest(pos, COLLISIONTEAM_GOOD, 0, 1, -1);
 }
 
 static Vec2i GetClosestPlayerPos(Vec2i pos)
@@ -189,13 +140,8 @@ static Vec2i GetClosestPlayerPos(Vec2i pos)
 
 static int IsCloseToPlayer(Vec2i pos)
 {
-	TActor *closestPlayer = GetClosestPlayer(pos);
-	if (closestPlayer && CHEBYSHEV_DISTANCE(
-			pos.x, pos.y, closestPlayer->x, closestPlayer->y) < (32 << 8))
-	{
-		return 1;
-	}
-	return 0;
+	return ActorGridGetClosest(
+		pos, COLLISIONTEAM_GOOD, 0, 1, (32 << 8) - 1) != NULL;
 }
 
 static int Follow(TActor * actor)
@@ -416,16 +362,14 @@ static void PlaceBaddie(TActor *actor)
 	for (i = 0; i < 100; i++)	// Don't try forever trying to place baddie
 	{
 		// Try spawning out of players' sights
-		TActor *closestPlayer = NULL;
 		do
 		{
 			actor->x = (rand() % (XMAX * TILE_WIDTH)) << 8;
 			actor->y = (rand() % (YMAX * TILE_HEIGHT)) << 8;
-			closestPlayer = GetClosestPlayer(Vec2iNew(actor->x, actor->y));
 		}
-		while (closestPlayer && CHEBYSHEV_DISTANCE(
-			actor->x, actor->y, closestPlayer->x, closestPlayer->y) <
-			256 * 150);
+		while (ActorGridGetClosest(
+			Vec2iNew(actor->x, actor->y), COLLISIONTEAM_GOOD, 0, 1,
+			256 * 150 - 1));
 		if (IsActorPositionValid(actor))
 		{
 			hasPlaced = 1;
@@ -59,6 +59,7 @@
 #include "objs.h"
 #include "pic_manager.h"
 #include "text.h"
+#include "tile_item_index.h"
 
 
 #define MAP_FACTOR 2
@@ -73,6 +74,11 @@ color_t colorBlueDoor = { 0, 252, 252, 255 };
 color_t colorRedDoor = { 132, 0, 0, 255 };
 color_t colorExit = { 255, 255, 255, 255 };
 
+// Per-mission automap images, one pixel per tile, transparent (zero alpha)
+// where nothing is drawn: the tiles seen so far, and all the tiles
+// Tiles are repainted as they are visited or changed
+static color_t sAutomap[YMAX][XMAX];
+static color_t sAutomapAll[YMAX][XMAX];
 
 
 static void DisplayPlayer(TActor *player, Vec2i pos, int scale)
@@ -88,7 +94,7 @@ static void DisplayPlayer(TActor *player, Vec2i pos, int scale)
 		PicPaletted *pic = PicManagerGetOldPic(&gPicManager, picIdx);
 		pos.x -= pic->w / 2;
 		pos.y -= pic->h / 2;
-		DrawTTPic(pos.x, pos.y, pic, c->table);
+		DrawTTPic(&gGraphicsDevice, pos.x, pos.y, pic, c->table);
 	}
 	else
 	{
@@ -229,53 +235,106 @@ void DrawDot(TTileItem *t, color_t color, Vec2i pos, int scale)
 	Draw_Rect(pos.x, pos.y, scale, scale, color);
 }
 
-static void DrawMap(
-	Tile map[YMAX][XMAX],
-	Vec2i center, Vec2i centerOn, Vec2i size,
-	int scale, int flags)
+static color_t TileColor(int x, int y)
+{
+	Tile *tile = &Map(x, y);
+	color_t color = colorBlack;
+	if (tile->flags & MAPTILE_IS_NOTHING)
+	{
+		color.a = 0;
+	}
+	else if (tile->flags & MAPTILE_IS_WALL)
+	{
+		color = colorWall;
+	}
+	else if (tile->flags & MAPTILE_NO_WALK)
+	{
+		color = DoorColor(x, y);
+	}
+	else
+	{
+		color = colorFloor;
+	}
+	return color;
+}
+
+static void PaintTile(int x, int y)
+{
+	sAutomapAll[y][x] = TileColor(x, y);
+	sAutomap[y][x] = sAutomapAll[y][x];
+	if (!MapIsVisited(x, y))
+	{
+		sAutomap[y][x].a = 0;
+	}
+}
+
+void AutomapInit(void)
 {
 	int x, y;
-	Vec2i mapPos = Vec2iAdd(center, Vec2iScale(centerOn, -scale));
 	for (y = 0; y < YMAX; y++)
 	{
-		int i;
-		for (i = 0; i < scale; i++)
+		for (x = 0; x < XMAX; x++)
+		{
+			PaintTile(x, y);
+		}
+	}
+}
+
+void AutomapUpdateTile(Vec2i tile)
+{
+	PaintTile(tile.x, tile.y);
+}
+
+// Get the range of tiles, drawn at scale from mapPos, that are within the
+// clipping rectangle expanded by margin pixels
+static void GetVisibleTiles(
+	Vec2i mapPos, int scale, int margin, Vec2i *start, Vec2i *end)
+{
+	const BlitClipping *clip = &gGraphicsDevice.clipping;
+	const int left = clip->left - margin - mapPos.x;
+	const int top = clip->top - margin - mapPos.y;
+	const int right = clip->right + margin - mapPos.x;
+	const int bottom = clip->bottom + margin - mapPos.y;
+	start->x = MAX(0, left / scale);
+	start->y = MAX(0, top / scale);
+	end->x = right < 0 ? -1 : MIN(XMAX - 1, right / scale);
+	end->y = bottom < 0 ? -1 : MIN(YMAX - 1, bottom / scale);
+}
+
+static void DrawMap(
+	Vec2i center, Vec2i centerOn, Vec2i size, int scale, int flags)
+{
+	const int stride = gGraphicsDevice.cachedConfig.ResolutionWidth;
+	const BlitClipping *clip = &gGraphicsDevice.clipping;
+	color_t (*image)[XMAX] =
+		(flags & AUTOMAP_FLAGS_SHOWALL) ? sAutomapAll : sAutomap;
+	Vec2i mapPos = Vec2iAdd(center, Vec2iScale(centerOn, -scale));
+	// Copy the clipped part of the image, scaled
+	int left = MAX(clip->left, mapPos.x);
+	int right = MIN(clip->right, mapPos.x + XMAX * scale - 1);
+	int top = MAX(clip->top, mapPos.y);
+	int bottom = MIN(clip->bottom, mapPos.y + YMAX * scale - 1);
+	int x, y;
+	for (y = top; y <= bottom; y++)
+	{
+		const color_t *row = image[(y - mapPos.y) / scale];
+		Uint32 *target = gGraphicsDevice.buf + y * stride;
+		for (x = left; x <= right; x++)
 		{
-			for (x = 0; x < XMAX; x++)
+			color_t color = row[(x - mapPos.x) / scale];
+			if (color.a == 0)
 			{
-				Tile *tile = &map[y][x];
-				if (!(tile->flags & MAPTILE_IS_NOTHING) &&
-					(tile->isVisited || (flags & AUTOMAP_FLAGS_SHOWALL)))
-				{
-					int j;
-					for (j = 0; j < scale; j++)
-					{
-						Vec2i drawPos = Vec2iNew(
-							mapPos.x + x*scale + j,
-							mapPos.y + y*scale + i);
-						color_t color = colorBlack;
-						if (tile->flags & MAPTILE_IS_WALL)
-						{
-							color = colorWall;
-						}
-						else if (tile->flags & MAPTILE_NO_WALK)
-						{
-							color = DoorColor(x, y);
-						}
-						else
-						{
-							color = colorFloor;
-						}
-						if (!ColorEquals(color, colorBlack))
-						{
-							if (flags & AUTOMAP_FLAGS_MASK)
-							{
-								color.a = MASK_ALPHA;
-							}
-							Draw_Point(drawPos.x, drawPos.y, color);
-						}
-					}
-				}
+				continue;
+			}
+			if (flags & AUTOMAP_FLAGS_MASK)
+			{
+				color.a = MASK_ALPHA;
+				target[x] = PixelFromColor(
+					ColorAlphaBlend(PixelToColor(target[x]), color));
+			}
+			else
+			{
+				target[x] = PixelFromColor(color);
 			}
 		}
 	}
@@ -290,18 +349,22 @@ static void DrawMap(
 	}
 }
 
-static void DrawObjectivesAndKeys(
-	Tile map[YMAX][XMAX], Vec2i pos, int scale, int flags)
+static void DrawObjectivesAndKeys(Vec2i pos, int scale, int flags)
 {
+	// Only the tiles on screen; objective crosses are a pixel wider
+	Vec2i start, end;
 	int y;
-	for (y = 0; y < YMAX; y++)
+	GetVisibleTiles(pos, scale, 1, &start, &end);
+	for (y = start.y; y <= end.y; y++)
 	{
 		int x;
-		for (x = 0; x < XMAX; x++)
+		for (x = start.x; x <= end.x; x++)
 		{
-			TTileItem *t = map[y][x].things;
-			while (t)
+			const TileItemCell *cell = TileItemIndexGetCell(x, y);
+			int i;
+			for (i = 0; i < cell->count; i++)
 			{
+				TTileItem *t = cell->entries[i].item;
 				if ((t->flags & TILEITEM_OBJECTIVE) != 0)
 				{
 					int obj = ObjectiveFromTileItem(t->flags);
@@ -310,7 +373,7 @@ static void DrawObjectivesAndKeys(
 						(flags & AUTOMAP_FLAGS_SHOWALL))
 					{
 						if ((objFlags & OBJECTIVE_POSKNOWN) ||
-							map[y][x].isVisited ||
+							MapIsVisited(x, y) ||
 							(flags & AUTOMAP_FLAGS_SHOWALL))
 						{
 							DisplayObjective(t, obj, pos, scale, flags);
@@ -319,7 +382,7 @@ static void DrawObjectivesAndKeys(
 				}
 				else if (t->kind == KIND_OBJECT &&
 					t->data &&
-					map[y][x].isVisited)
+					MapIsVisited(x, y))
 				{
 					color_t dotColor = colorBlack;
 					switch (((TObject *)t->data)->objectIndex)
@@ -344,8 +407,6 @@ static void DrawObjectivesAndKeys(
 						DrawDot(t, dotColor, pos, scale);
 					}
 				}
-
-				t = t->next;
 			}
 		}
 	}
@@ -371,15 +432,9 @@ void AutomapDraw(int flags)
 		}
 	}
 
-	DrawMap(
-		gMap,
-		mapCenter,
-		centerOn,
-		Vec2iNew(XMAX, YMAX),
-		MAP_FACTOR,
-		flags);
+	DrawMap(mapCenter, centerOn, Vec2iNew(XMAX, YMAX), MAP_FACTOR, flags);
 
-	DrawObjectivesAndKeys(gMap, pos, MAP_FACTOR, flags);
+	DrawObjectivesAndKeys(pos, MAP_FACTOR, flags);
 
 	for (i = 0; i < MAX_PLAYERS; i++)
 	{
@@ -394,7 +449,6 @@ void AutomapDraw(int flags)
 }
 
 void AutomapDrawRegion(
-	Tile map[YMAX][XMAX],
 	Vec2i pos, Vec2i size, Vec2i mapCenter,
 	int scale, int flags)
 {
@@ -405,7 +459,7 @@ void AutomapDrawRegion(
 		&gGraphicsDevice,
 		pos.x, pos.y, pos.x + size.x - 1, pos.y + size.y - 1);
 	pos = Vec2iAdd(pos, Vec2iScaleDiv(size, 2));
-	DrawMap(map, pos, mapCenter, size, scale, flags);
+	DrawMap(pos, mapCenter, size, scale, flags);
 	centerOn = Vec2iAdd(pos, Vec2iScale(mapCenter, -scale));
 	for (i = 0; i < MAX_PLAYERS; i++)
 	{
@@ -415,7 +469,7 @@ void AutomapDrawRegion(
 			DisplayPlayer(player, centerOn, scale);
 		}
 	}
-	DrawObjectivesAndKeys(gMap, centerOn, scale, flags);
+	DrawObjectivesAndKeys(centerOn, scale, flags);
 	DisplayExit(centerOn, scale, flags);
 	GraphicsSetBlitClip(
 		&gGraphicsDevice,
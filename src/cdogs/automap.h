@@ -35,9 +35,12 @@
 #define AUTOMAP_FLAGS_SHOWALL 0x01
 #define AUTOMAP_FLAGS_MASK 0x02
 
+// Repaint the per-mission automap images, after the map is set up
+void AutomapInit(void);
+// Repaint a tile, after it is visited or its flags change
+void AutomapUpdateTile(Vec2i tile);
 void AutomapDraw(int flags);
 void AutomapDrawRegion(
-	Tile map[YMAX][XMAX],
 	Vec2i pos, Vec2i size, Vec2i mapCenter,
 	int scale, int flags);
 
@@ -56,134 +56,202 @@
 #include <hqx.h>
 #include <SDL.h>
 
+#include "blit_simd.h"
 #include "config.h"
 #include "grafx.h"
 #include "palette.h"
 #include "utils.h" /* for debug() */
+#include "worker_pool.h"
 
 
-color_t PixelToColor(GraphicsDevice *device, Uint32 pixel)
+// Clip a pic of size drawn at pos against the clipping rectangle
+// This is the only clipping test per blit; returns 0 if the pic is not
+// visible at all, otherwise sets src to the visible part of the pic, in pic
+// coordinates (inclusive). For pics fully inside the clip, that's the whole
+// pic.
+static int ClipPic(
+	const BlitClipping *clip, Vec2i pos, Vec2i size, BlitClipping *src)
 {
-	color_t c;
-	SDL_GetRGB(pixel, device->screen->format, &c.r, &c.g, &c.b);
-	c.a = 255;
-	return c;
+	src->left = MAX(0, clip->left - pos.x);
+	src->top = MAX(0, clip->top - pos.y);
+	src->right = MIN(size.x - 1, clip->right - pos.x);
+	src->bottom = MIN(size.y - 1, clip->bottom - pos.y);
+	return src->left <= src->right && src->top <= src->bottom;
 }
-Uint32 PixelFromColor(GraphicsDevice *device, color_t color)
+
+int BlitMeasure(GraphicsDevice *device, Vec2i pos, Vec2i size)
 {
-	return SDL_MapRGB(device->screen->format, color.r, color.g, color.b);
+	BlitClipping *m = device->measure;
+	BlitClipping src;
+	if (m == NULL)
+	{
+		return 0;
+	}
+	if (ClipPic(&device->clipping, pos, size, &src))
+	{
+		m->left = MIN(m->left, pos.x + src.left);
+		m->top = MIN(m->top, pos.y + src.top);
+		m->right = MAX(m->right, pos.x + src.right);
+		m->bottom = MAX(m->bottom, pos.y + src.bottom);
+	}
+	return 1;
 }
 
-void Blit(int x, int y, PicPaletted *pic, void *table, int mode)
+// Per-pixel blit kernels
+// These are specialised by macro, one per blit mode, so that the inner loops
+// have no clipping checks and no mode branches; the only test left is the
+// per-pixel transparency test in the transparent kernels.
+// Each kernel draws the visible part (src) of a pic at pos.
+// Paletted kernels go through a LUT: either the palette LUT or a fused
+// translation table LUT, so translated and untranslated blits share kernels.
+#define PALETTED_KERNEL(_name, _isDrawn)\
+static void _name(\
+	GraphicsDevice *device, Vec2i pos, const PicPaletted *pic,\
+	const BlitClipping *src, const Uint32 *lut)\
+{\
+	const int stride = device->cachedConfig.ResolutionWidth;\
+	int y;\
+	for (y = src->top; y <= src->bottom; y++)\
+	{\
+		const unsigned char *row = pic->data + y * pic->w;\
+		Uint32 *target = device->buf + (pos.y + y) * stride + pos.x;\
+		int x;\
+		for (x = src->left; x <= src->right; x++)\
+		{\
+			if (_isDrawn)\
+			{\
+				target[x] = lut[row[x]];\
+			}\
+		}\
+	}\
+}
+PALETTED_KERNEL(BlitPalettedOpaque, 1)
+PALETTED_KERNEL(BlitPalettedTransparent, row[x] != 0)
+#undef PALETTED_KERNEL
+
+#define TINT_KERNEL(_name, _isTransparent)\
+static void _name(\
+	GraphicsDevice *device, Vec2i pos, const PicPaletted *pic,\
+	const BlitClipping *src, const TintLUT *tint)\
+{\
+	const int stride = device->cachedConfig.ResolutionWidth;\
+	int y;\
+	for (y = src->top; y <= src->bottom; y++)\
+	{\
+		const unsigned char *row = pic->data + y * pic->w;\
+		Uint32 *target = device->buf + (pos.y + y) * stride + pos.x;\
+		int x;\
+		for (x = src->left; x <= src->right; x++)\
+		{\
+			if (!(_isTransparent) || row[x] != 0)\
+			{\
+				target[x] = TintLUTPixel(tint, target[x]);\
+			}\
+		}\
+	}\
+}
+TINT_KERNEL(BlitTintOpaque, 0)
+TINT_KERNEL(BlitTintTransparent, 1)
+#undef TINT_KERNEL
+
+// Masked kernels run a row kernel (see blit_simd.h) over each row
+static void BlitMaskedRows(
+	GraphicsDevice *device, Vec2i pos, const Pic *pic,
+	const BlitClipping *src, color_t mask,
+	void (*rowFunc)(uint32_t *, const color_t *, int, color_t))
 {
-	int yoff, xoff;
-	unsigned char *current = pic->data;
-	unsigned char *xlate = (unsigned char *)table;
+	const int stride = device->cachedConfig.ResolutionWidth;
+	const int w = src->right - src->left + 1;
+	int y;
+	for (y = src->top; y <= src->bottom; y++)
+	{
+		rowFunc(
+			device->buf + (pos.y + y) * stride + pos.x + src->left,
+			pic->data + y * pic->size.x + src->left,
+			w, mask);
+	}
+}
 
-	int i;
+void Blit(
+	GraphicsDevice *device, int x, int y, PicPaletted *pic, void *table,
+	int mode)
+{
+	// Palette or table+palette in one LUT, for one load per pixel
+	const Uint32 *lut = table != NULL ?
+		PaletteGetTranslationLUT((const TranslationTable *)table) :
+		PaletteGetLUT();
+	Vec2i pos = Vec2iNew(x, y);
+	BlitClipping src;
 
 	assert(!(mode & BLIT_BACKGROUND));
 
-	for (i = 0; i < pic->h; i++)
+	if (BlitMeasure(device, pos, Vec2iNew(pic->w, pic->h)))
 	{
-		int j;
+		return;
+	}
 
-		yoff = i + y;
-		if (yoff > gGraphicsDevice.clipping.bottom)
-		{
-			break;
-		}
-		if (yoff < gGraphicsDevice.clipping.top)
-		{
-			current += pic->w;
-			continue;
-		}
-		yoff *= gGraphicsDevice.cachedConfig.ResolutionWidth;
-		for (j = 0; j < pic->w; j++)
-		{
-			xoff = j + x;
-			if (xoff < gGraphicsDevice.clipping.left)
-			{
-				current++;
-				continue;
-			}
-			if (xoff > gGraphicsDevice.clipping.right)
-			{
-				current += pic->w - j;
-				break;
-			}
-			if ((mode & BLIT_TRANSPARENT && *current) || !(mode & BLIT_TRANSPARENT))
-			{
-				Uint32 *target = gGraphicsDevice.buf + yoff + xoff;
-				if (table != NULL)
-				{
-					*target = LookupPalette(xlate[*current]);
-				}
-				else
-				{
-					*target = LookupPalette(*current);
-				}
-			}
-			current++;
-		}
+	if ((mode & BLIT_TRANSPARENT) && pic->rle != NULL)
+	{
+		BlitRLE(device, x, y, pic, lut);
+		return;
+	}
+	if (!ClipPic(&device->clipping, pos, Vec2iNew(pic->w, pic->h), &src))
+	{
+		return;
+	}
+	if (mode & BLIT_TRANSPARENT)
+	{
+		BlitPalettedTransparent(device, pos, pic, &src, lut);
+	}
+	else
+	{
+		BlitPalettedOpaque(device, pos, pic, &src, lut);
 	}
 }
 
-void BlitBackground(int x, int y, PicPaletted *pic, HSV *tint, int mode)
+void BlitBackground(
+	GraphicsDevice *device, int x, int y, PicPaletted *pic, HSV *tint,
+	int mode)
 {
-	int yoff, xoff;
-	unsigned char *current = pic->data;
-
-	int i;
+	Vec2i pos = Vec2iNew(x, y);
+	BlitClipping src;
 
 	assert(mode & BLIT_BACKGROUND);
 
-	for (i = 0; i < pic->h; i++)
+	if (BlitMeasure(device, pos, Vec2iNew(pic->w, pic->h)))
 	{
-		int j;
+		return;
+	}
 
-		yoff = i + y;
-		if (yoff > gGraphicsDevice.clipping.bottom)
-		{
-			break;
-		}
-		if (yoff < gGraphicsDevice.clipping.top)
+	if ((mode & BLIT_TRANSPARENT) && tint != NULL && pic->rle != NULL)
+	{
+		BlitRLEBackground(device, x, y, pic, tint);
+		return;
+	}
+	if (!ClipPic(&device->clipping, pos, Vec2iNew(pic->w, pic->h), &src))
+	{
+		return;
+	}
+	if (tint == NULL)
+	{
+		// Without a tint, the pic is drawn as-is
+		if (mode & BLIT_TRANSPARENT)
 		{
-			current += pic->w;
-			continue;
+			BlitPalettedTransparent(device, pos, pic, &src, PaletteGetLUT());
 		}
-		yoff *= gGraphicsDevice.cachedConfig.ResolutionWidth;
-		for (j = 0; j < pic->w; j++)
+		else
 		{
-			xoff = j + x;
-			if (xoff < gGraphicsDevice.clipping.left)
-			{
-				current++;
-				continue;
-			}
-			if (xoff > gGraphicsDevice.clipping.right)
-			{
-				current += pic->w - j;
-				break;
-			}
-			if ((mode & BLIT_TRANSPARENT && *current) || !(mode & BLIT_TRANSPARENT))
-			{
-				Uint32 *target = gGraphicsDevice.buf + yoff + xoff;
-				if (tint != NULL)
-				{
-					color_t targetColor =
-						PixelToColor(&gGraphicsDevice, *target);
-					color_t blendedColor = ColorTint(targetColor, *tint);
-					*target = PixelFromColor(&gGraphicsDevice, blendedColor);
-				}
-				else
-				{
-					*target = LookupPalette(*current);
-				}
-			}
-			current++;
+			BlitPalettedOpaque(device, pos, pic, &src, PaletteGetLUT());
 		}
 	}
+	else if (mode & BLIT_TRANSPARENT)
+	{
+		BlitTintTransparent(device, pos, pic, &src, PaletteGetTintLUT(tint));
+	}
+	else
+	{
+		BlitTintOpaque(device, pos, pic, &src, PaletteGetTintLUT(tint));
+	}
 }
 
 void BlitMasked(
@@ -193,335 +261,818 @@ void BlitMasked(
 	color_t mask,
 	int isTransparent)
 {
-	color_t *current = pic->data;
-	int i;
+	BlitClipping src;
+	if (BlitMeasure(device, Vec2iAdd(pos, pic->offset), pic->size))
+	{
+		return;
+	}
+	if (isTransparent && pic->rle != NULL)
+	{
+		BlitRLEMasked(device, pic, pos, mask);
+		return;
+	}
 	pos = Vec2iAdd(pos, pic->offset);
-	for (i = 0; i < pic->size.y; i++)
+	if (!ClipPic(&device->clipping, pos, pic->size, &src))
+	{
+		return;
+	}
+	if (isTransparent)
+	{
+		BlitMaskedRows(
+			device, pos, pic, &src, mask,
+			gBlitRowKernels.MaskedRowTransparent);
+	}
+	else
+	{
+		BlitMaskedRows(
+			device, pos, pic, &src, mask, gBlitRowKernels.MaskedRow);
+	}
+}
+
+void BlitPixels(
+	GraphicsDevice *device, const Uint32 *pixels, int stride,
+	Vec2i size, Vec2i pos)
+{
+	const int targetStride = device->cachedConfig.ResolutionWidth;
+	BlitClipping src;
+	int y;
+	if (BlitMeasure(device, pos, size) ||
+		!ClipPic(&device->clipping, pos, size, &src))
+	{
+		return;
+	}
+	for (y = src.top; y <= src.bottom; y++)
+	{
+		memcpy(
+			device->buf + (pos.y + y) * targetStride + pos.x + src.left,
+			pixels + y * stride + src.left,
+			(src.right - src.left + 1) * sizeof *pixels);
+	}
+}
+
+void BlitFill(GraphicsDevice *device, Vec2i size, Vec2i pos, Uint32 pixel)
+{
+	const int stride = device->cachedConfig.ResolutionWidth;
+	BlitClipping src;
+	int y;
+	if (BlitMeasure(device, pos, size) ||
+		!ClipPic(&device->clipping, pos, size, &src))
+	{
+		return;
+	}
+	for (y = src.top; y <= src.bottom; y++)
 	{
-		int j;
-		int yoff = i + pos.y;
-		if (yoff > device->clipping.bottom)
+		Uint32 *target = device->buf + (pos.y + y) * stride + pos.x;
+		int x;
+		for (x = src.left; x <= src.right; x++)
 		{
-			break;
+			target[x] = pixel;
 		}
-		if (yoff < device->clipping.top)
+	}
+}
+
+// Clip a run of a pic drawn at x against the clipping rectangle
+// Returns 0 if the run is entirely clipped; otherwise start and end
+// (inclusive) are set to the visible part of the run in screen coordinates
+// Runs are in increasing x order, so once start is past the right clip edge,
+// the rest of the row can be skipped
+static INLINE int ClipRun(
+	const BlitClipping *clip, const PicRun *run, int x, int *start, int *end)
+{
+	*start = x + run->x;
+	*end = *start + run->len - 1;
+	if (*end < clip->left || *start > clip->right)
+	{
+		return 0;
+	}
+	*start = MAX(*start, clip->left);
+	*end = MIN(*end, clip->right);
+	return 1;
+}
+
+void BlitRLE(
+	GraphicsDevice *device, int x, int y, const PicPaletted *pic,
+	const Uint32 *lut)
+{
+	const BlitClipping *clip = &device->clipping;
+	int stride = device->cachedConfig.ResolutionWidth;
+	int row = MAX(0, clip->top - y);
+	int rowLast = MIN(pic->h - 1, clip->bottom - y);
+	if (BlitMeasure(device, Vec2iNew(x, y), Vec2iNew(pic->w, pic->h)))
+	{
+		return;
+	}
+	for (; row <= rowLast; row++)
+	{
+		const PicRun *run = pic->rle->runs + pic->rle->rowStarts[row];
+		const PicRun *runEnd = pic->rle->runs + pic->rle->rowStarts[row + 1];
+		Uint32 *target = device->buf + (y + row) * stride;
+		const unsigned char *src = pic->data + row * pic->w;
+		for (; run < runEnd; run++)
 		{
-			current += pic->size.x;
-			continue;
+			int start, end, j;
+			if (!ClipRun(clip, run, x, &start, &end))
+			{
+				if (start > clip->right)
+				{
+					break;
+				}
+				continue;
+			}
+			for (j = start; j <= end; j++)
+			{
+				target[j] = lut[src[j - x]];
+			}
 		}
-		yoff *= device->cachedConfig.ResolutionWidth;
-		for (j = 0; j < pic->size.x; j++)
+	}
+}
+
+void BlitRLEBackground(
+	GraphicsDevice *device, int x, int y, const PicPaletted *pic, HSV *tint)
+{
+	const BlitClipping *clip = &device->clipping;
+	int stride = device->cachedConfig.ResolutionWidth;
+	int row = MAX(0, clip->top - y);
+	int rowLast = MIN(pic->h - 1, clip->bottom - y);
+	const TintLUT *lut;
+	if (BlitMeasure(device, Vec2iNew(x, y), Vec2iNew(pic->w, pic->h)))
+	{
+		return;
+	}
+	lut = PaletteGetTintLUT(tint);
+	for (; row <= rowLast; row++)
+	{
+		const PicRun *run = pic->rle->runs + pic->rle->rowStarts[row];
+		const PicRun *runEnd = pic->rle->runs + pic->rle->rowStarts[row + 1];
+		Uint32 *target = device->buf + (y + row) * stride;
+		for (; run < runEnd; run++)
 		{
-			Uint32 *target;
-			color_t c;
-			int xoff = j + pos.x;
-			if (xoff < device->clipping.left)
+			int start, end, j;
+			if (!ClipRun(clip, run, x, &start, &end))
 			{
-				current++;
+				if (start > clip->right)
+				{
+					break;
+				}
 				continue;
 			}
-			if (xoff > device->clipping.right)
+			for (j = start; j <= end; j++)
 			{
-				current += pic->size.x - j;
-				break;
+				target[j] = TintLUTPixel(lut, target[j]);
 			}
-			if (isTransparent && ColorEquals(*current, colorBlack))
+		}
+	}
+}
+
+void BlitRLEMasked(
+	GraphicsDevice *device, const Pic *pic, Vec2i pos, color_t mask)
+{
+	const BlitClipping *clip = &device->clipping;
+	int stride = device->cachedConfig.ResolutionWidth;
+	int row, rowLast;
+	pos = Vec2iAdd(pos, pic->offset);
+	if (BlitMeasure(device, pos, pic->size))
+	{
+		return;
+	}
+	row = MAX(0, clip->top - pos.y);
+	rowLast = MIN(pic->size.y - 1, clip->bottom - pos.y);
+	for (; row <= rowLast; row++)
+	{
+		const PicRun *run = pic->rle->runs + pic->rle->rowStarts[row];
+		const PicRun *runEnd = pic->rle->runs + pic->rle->rowStarts[row + 1];
+		Uint32 *target = device->buf + (pos.y + row) * stride;
+		const color_t *src = pic->data + row * pic->size.x;
+		for (; run < runEnd; run++)
+		{
+			int start, end;
+			if (!ClipRun(clip, run, pos.x, &start, &end))
 			{
-				current++;
+				if (start > clip->right)
+				{
+					break;
+				}
 				continue;
 			}
-			target = device->buf + yoff + xoff;
-			c = ColorMult(*current, mask);
-			*target = PixelFromColor(device, c);
-			current++;
+			gBlitRowKernels.MaskedRow(
+				target + start, src + start - pos.x, end - start + 1, mask);
 		}
 	}
 }
 
-#define PixelIndex(x, y, w)		(y * w + x)
-
-static INLINE
-void Scale8(Uint32 *d, const Uint32 *s, const int w, const int h, const int sf)
+void BlitRLEPixels(
+	GraphicsDevice *device, const Uint32 *pixels, const PicRLE *rle,
+	Vec2i size, Vec2i pos)
 {
-	int sx;
-	int sy;
-	int f = sf;
-
-	int dx, dy, dw;
-
-	if (f > 4)
+	const BlitClipping *clip = &device->clipping;
+	int stride = device->cachedConfig.ResolutionWidth;
+	int row = MAX(0, clip->top - pos.y);
+	int rowLast = MIN(size.y - 1, clip->bottom - pos.y);
+	if (BlitMeasure(device, pos, size))
 	{
-		f = 4;	/* max 4x for the moment */
+		return;
 	}
-
-	dw = w * f;
-
-	for (sy = 0; sy < h; sy++) {
-		dy = f * sy;
-		for (sx = 0; sx < w; sx++)
+	for (; row <= rowLast; row++)
+	{
+		const PicRun *run = rle->runs + rle->rowStarts[row];
+		const PicRun *runEnd = rle->runs + rle->rowStarts[row + 1];
+		Uint32 *target = device->buf + (pos.y + row) * stride;
+		const Uint32 *src = pixels + row * size.x;
+		for (; run < runEnd; run++)
 		{
-			Uint32 p = s[PixelIndex(sx, sy, w)];
-			dx = f * sx;
-
-			switch (f) {
-				case 4:
-					/* right side */
-					d[PixelIndex((dx + 3),	(dy + 1),	dw)] = p;
-					d[PixelIndex((dx + 3),	(dy + 2),	dw)] = p;
-					d[PixelIndex((dx + 3),	dy,		dw)] = p;
-
-					/* bottom row */
-					d[PixelIndex(dx,	(dy + 3),	dw)] = p;
-					d[PixelIndex((dx + 1),	(dy + 3),	dw)] = p;
-					d[PixelIndex((dx + 2),	(dy + 3),	dw)] = p;
-
-					/* bottom right */
-					d[PixelIndex((dx + 3),	(dy + 3),	dw)] = p;
-
-				case 3:
-					/* right side */
-					d[PixelIndex((dx + 2),	(dy + 1),	dw)] = p;
-					d[PixelIndex((dx + 2),	dy,		dw)] = p;
-
-					/* bottom row */
-					d[PixelIndex(dx,	(dy + 2),	dw)] = p;
-					d[PixelIndex((dx + 1),	(dy + 2),	dw)] = p;
-
-					/* bottom right */
-					d[PixelIndex((dx + 2),	(dy + 2),	dw)] = p;
-
-				case 2:
-					d[PixelIndex((dx + 1),	dy,		dw)] = p;
-					d[PixelIndex((dx + 1),	(dy + 1),	dw)] = p;
-					d[PixelIndex(dx,	(dy + 1),	dw)] = p;
-
-				default:
-					d[PixelIndex(dx,	dy,		dw)] = p;
+			int start, end;
+			if (!ClipRun(clip, run, pos.x, &start, &end))
+			{
+				if (start > clip->right)
+				{
+					break;
+				}
+				continue;
 			}
+			memcpy(
+				target + start, src + start - pos.x,
+				(end - start + 1) * sizeof *src);
 		}
 	}
 }
 
-static Uint32 PixAvg(Uint32 p1, Uint32 p2)
+// Post-processing, from the framebuffer straight into the screen surface:
+// brightness, then scaling, in one pass over the rows.
+// Brightness is a per-channel LUT, applied to each source row as it is read,
+// so the framebuffer itself is left as drawn.
+// The frame is split into horizontal bands of source rows, which are scaled
+// in parallel on the worker pool. Each band has its own scratch rows, kept
+// between frames, so nothing is allocated per frame.
+
+static int sBrightness = 0;
+static uint8_t sBrightnessLUT[256];
+
+typedef struct
+{
+	Uint32 *data;
+	int size;
+} ScaleScratch;
+static ScaleScratch *sScratch = NULL;
+static int sScratchCount = 0;
+
+// Get the LUT for the brightness; NULL if brightness has no effect
+static const uint8_t *GetBrightnessLUT(int brightness)
 {
-	union
+	if (brightness == 0)
 	{
-		Uint8 rgba[4];
-		Uint32 out;
-	} u1, u2;
+		return NULL;
+	}
+	if (brightness != sBrightness)
+	{
+		double f = pow(1.07177346254, brightness);	// 10th root of 2; i.e. n^10 = 2
+		int i;
+		for (i = 0; i < 256; i++)
+		{
+			sBrightnessLUT[i] = (uint8_t)CLAMP(f * i, 0, 255);
+		}
+		sBrightness = brightness;
+	}
+	return sBrightnessLUT;
+}
+static void BrightenRow(
+	Uint32 *dst, const Uint32 *src, int n, const uint8_t *lut)
+{
 	int i;
-	u1.out = p1;
-	u2.out = p2;
-	for (i = 0; i < 4; i++)
+	for (i = 0; i < n; i++)
 	{
-		u1.rgba[i] = (Uint8)CLAMP(((int)u1.rgba[i] + u2.rgba[i]) / 2, 0, 255);
+		dst[i] =
+			((Uint32)lut[(src[i] >> PIXEL_R_SHIFT) & 0xFF] << PIXEL_R_SHIFT) |
+			((Uint32)lut[(src[i] >> PIXEL_G_SHIFT) & 0xFF] << PIXEL_G_SHIFT) |
+			((Uint32)lut[(src[i] >> PIXEL_B_SHIFT) & 0xFF] << PIXEL_B_SHIFT);
 	}
-	return u1.out;
 }
-static Uint32 Pix3rds(Uint32 p1, Uint32 p2)
+
+static Uint32 *GetScratch(ScaleScratch *scratch, int size)
 {
-	union
+	if (size > scratch->size)
 	{
-		Uint8 rgba[4];
-		Uint32 out;
-	} u1, u2;
-	int i;
-	u1.out = p1;
-	u2.out = p2;
-	for (i = 0; i < 4; i++)
+		CREALLOC(scratch->data, size * sizeof *scratch->data);
+		scratch->size = size;
+	}
+	return scratch->data;
+}
+
+// Copy a source row, brightened, into row, which has one extra pixel
+// repeating the last, so that the right neighbours are clamped at the edge
+static void ReadRowPadded(
+	Uint32 *row, const Uint32 *src, int w, const uint8_t *lut)
+{
+	if (lut != NULL)
+	{
+		BrightenRow(row, src, w, lut);
+	}
+	else
 	{
-		u1.rgba[i] = (Uint8)CLAMP(((int)u1.rgba[i] + u2.rgba[i]*2) / 3, 0, 255);
+		memcpy(row, src, w * sizeof *row);
 	}
-	return u1.out;
+	row[w] = row[w - 1];
 }
-static void Bilinear(
-	Uint32 *dest, const Uint32 *src,
-	const int w, const int h,
-	const int scaleFactor)
+
+// Scale source rows y0 to y1 - 1 of a w x h frame by f
+typedef struct
 {
-	int sx, sy;
-	int dw = scaleFactor * w;
-	for (sy = 0; sy < h; sy++)
+	Uint32 *dest;
+	Uint32 *src;
+	int w;
+	int h;
+	int f;
+	int y0;
+	int y1;
+	const uint8_t *lut;
+	ScaleScratch *scratch;
+} ScaleBand;
+
+// Nearest neighbour: expand each row horizontally, then repeat it
+static void ScaleNearest(const ScaleBand *b)
+{
+	const int w = b->w;
+	const int f = b->f;
+	const int dw = w * f;
+	const Uint32 *src = b->src;
+	const uint8_t *lut = b->lut;
+	Uint32 *dest = b->dest;
+	Uint32 *scratch = GetScratch(b->scratch, w);
+	int y;
+	for (y = b->y0; y < b->y1; y++)
 	{
-		int dy = scaleFactor * sy;
-		for (sx = 0; sx < w; sx++)
+		const Uint32 *rows[4];
+		Uint32 *d = dest + y * f * dw;
+		int k;
+		rows[0] = src + y * w;
+		if (lut != NULL)
 		{
-			Uint32 p = src[PixelIndex(sx, sy, w)];
-			int dx = scaleFactor * sx;
-			switch (scaleFactor)
-			{
-			#define BLIT(x, y, pix) dest[PixelIndex((x), (y), dw)] = pix;
-			case 4:
-				{
-					// 0 1 2 3|g
-					// 4 5 6 7|h
-					// 8 9 a b|i
-					// c d e f|j
-					// k-l-m-n+o
-					Uint32 pg = src[PixelIndex(MIN(sx+1, w-1), sy, w)];
-					Uint32 p2 = PixAvg(p, pg);
-					Uint32 p1 = PixAvg(p, p2);
-					Uint32 p3 = PixAvg(p2, pg);
-					Uint32 pk = src[PixelIndex(sx, MIN(sy+1, h-1), w)];
-					Uint32 p8 = PixAvg(p, pk);
-					Uint32 p4 = PixAvg(p, p8);
-					Uint32 pc = PixAvg(p8, pk);
-					Uint32 po = src[PixelIndex(MIN(sx+1, w-1), MIN(sy+1, h-1), w)];
-					Uint32 pi = PixAvg(pg, po);
-					Uint32 pa = PixAvg(p8, pi);
-					Uint32 p9 = PixAvg(p8, pa);
-					Uint32 pb = PixAvg(pa, pi);
-					Uint32 p6 = PixAvg(p2, pa);
-					Uint32 p5 = PixAvg(p4, p6);
-					Uint32 pm = PixAvg(pk, po);
-					Uint32 pe = PixAvg(pa, pm);
-					Uint32 ph = PixAvg(pg, pi);
-					Uint32 p7 = PixAvg(p6, ph);
-					Uint32 pj = PixAvg(pi, po);
-					Uint32 pd = PixAvg(pc, pe);
-					Uint32 pf = PixAvg(pe, pj);
-					BLIT(dx, dy, p);
-					BLIT(dx+1, dy, p1);
-					BLIT(dx+2, dy, p2);
-					BLIT(dx+3, dy, p3);
-					BLIT(dx, dy+1, p4);
-					BLIT(dx+1, dy+1, p5);
-					BLIT(dx+2, dy+1, p6);
-					BLIT(dx+3, dy+1, p7);
-					BLIT(dx, dy+2, p8);
-					BLIT(dx+1, dy+2, p9);
-					BLIT(dx+2, dy+2, pa);
-					BLIT(dx+3, dy+2, pb);
-					BLIT(dx, dy+3, pc);
-					BLIT(dx+1, dy+3, pd);
-					BLIT(dx+2, dy+3, pe);
-					BLIT(dx+3, dy+3, pf);
-				}
-				break;
-			case 3:
-				{
-					// 0 1 2|9
-					// 3 4 5|a
-					// 6 7 8|b
-					// c-d-e+f
-					Uint32 p9 = src[PixelIndex(MIN(sx+1, w-1), sy, w)];
-					Uint32 p1 = Pix3rds(p9, p);
-					Uint32 p2 = Pix3rds(p, p9);
-					Uint32 pc = src[PixelIndex(sx, MIN(sy+1, h-1), w)];
-					Uint32 p3 = Pix3rds(pc, p);
-					Uint32 p6 = Pix3rds(p, pc);
-					Uint32 pf = src[PixelIndex(MIN(sx+1, w-1), MIN(sy+1, h-1), w)];
-					Uint32 pa = Pix3rds(pf, p9);
-					Uint32 pb = Pix3rds(p9, pf);
-					Uint32 p4 = Pix3rds(pa, p3);
-					Uint32 p5 = Pix3rds(p3, pa);
-					Uint32 p7 = Pix3rds(pb, p6);
-					Uint32 p8 = Pix3rds(p6, pb);
-					BLIT(dx, dy, p);
-					BLIT(dx+1, dy, p1);
-					BLIT(dx+2, dy, p2);
-					BLIT(dx, dy+1, p3);
-					BLIT(dx+1, dy+1, p4);
-					BLIT(dx+2, dy+1, p5);
-					BLIT(dx, dy+2, p6);
-					BLIT(dx+1, dy+2, p7);
-					BLIT(dx+2, dy+2, p8);
-				}
-				break;
-			case 2:
-				{
-					// 0 1|4
-					// 2 3|5
-					// 6-7+8
-					Uint32 p4 = src[PixelIndex(MIN(sx+1, w-1), sy, w)];
-					Uint32 p1 = PixAvg(p, p4);
-					Uint32 p6 = src[PixelIndex(sx, MIN(sy+1, h-1), w)];
-					Uint32 p2 = PixAvg(p, p6);
-					Uint32 p8 = src[PixelIndex(MIN(sx+1, w-1), MIN(sy+1, h-1), w)];
-					Uint32 p5 = PixAvg(p4, p8);
-					Uint32 p3 = PixAvg(p2, p5);
-					BLIT(dx, dy, p);
-					BLIT(dx+1, dy, p1);
-					BLIT(dx, dy+1, p2);
-					BLIT(dx+1, dy+1, p3);
-				}
-				break;
-			default:
-				BLIT(dx, dy, p);
-				break;
-			#undef BLIT
-			}
+			BrightenRow(scratch, rows[0], w, lut);
+			rows[0] = scratch;
+		}
+		rows[1] = rows[2] = rows[3] = rows[0];
+		gBlitRowKernels.InterleaveRow(d, rows, f, w);
+		for (k = 1; k < f; k++)
+		{
+			memcpy(d + k * dw, d, dw * sizeof *d);
 		}
 	}
 }
 
-static void ApplyBrightness(Uint32 *screen, Vec2i screenSize, int brightness)
+// Write one output row of the 4x bilinear scale:
+// x, (x + m) / 2, m, (m + x') / 2, for each x and its right neighbour x'
+// x is padded (see ReadRowPadded) and t is two rows of scratch
+static void BilinearRow4(
+	Uint32 *d, const Uint32 *x, const Uint32 *m, int w, Uint32 *t)
+{
+	const Uint32 *rows[4];
+	gBlitRowKernels.AvgRow(t, x, m, w);
+	gBlitRowKernels.AvgRow(t + w, m, x + 1, w);
+	rows[0] = x;
+	rows[1] = t;
+	rows[2] = m;
+	rows[3] = t + w;
+	gBlitRowKernels.InterleaveRow(d, rows, 4, w);
+}
+// One output row of the 3x bilinear scale:
+// x, (x' + 2x) / 3, (x + 2x') / 3
+static void BilinearRow3(Uint32 *d, const Uint32 *x, int w, Uint32 *t)
+{
+	const Uint32 *rows[3];
+	gBlitRowKernels.ThirdsRow(t, x + 1, x, w);
+	gBlitRowKernels.ThirdsRow(t + w, x, x + 1, w);
+	rows[0] = x;
+	rows[1] = t;
+	rows[2] = t + w;
+	gBlitRowKernels.InterleaveRow(d, rows, 3, w);
+}
+// One output row of the 2x bilinear scale: x, (x + x') / 2
+static void BilinearRow2(Uint32 *d, const Uint32 *x, int w, Uint32 *t)
+{
+	const Uint32 *rows[2];
+	gBlitRowKernels.AvgRow(t, x, x + 1, w);
+	rows[0] = x;
+	rows[1] = t;
+	gBlitRowKernels.InterleaveRow(d, rows, 2, w);
+}
+
+// Bilinear-style scale, where each output block is made from the source
+// pixel and its right, lower and lower-right neighbours by repeated
+// averaging (2x, 4x) or thirds (3x). The neighbours are clamped at the edges.
+// This works on whole rows: a is the current source row and b the one below,
+// and the in-between rows are averages of them.
+static void ScaleBilinear(const ScaleBand *band)
 {
-	double f = pow(1.07177346254, brightness);	// 10th root of 2; i.e. n^10 = 2
+	const int w = band->w;
+	const int h = band->h;
+	const int f = band->f;
+	const int dw = w * f;
+	const int pw = w + 1;
+	const Uint32 *src = band->src;
+	const uint8_t *lut = band->lut;
+	Uint32 *dest = band->dest;
+	// Padded rows a, b, v1, v2, v3 then unpadded rows for the rest
+	Uint32 *scratch = GetScratch(band->scratch, pw * 5 + w * 8);
+	Uint32 *a = scratch;
+	Uint32 *b = a + pw;
+	Uint32 *v1 = b + pw;
+	Uint32 *v2 = v1 + pw;
+	Uint32 *v3 = v2 + pw;
+	Uint32 *ma = v3 + pw;
+	Uint32 *mb = ma + w;
+	Uint32 *m1 = mb + w;
+	Uint32 *m2 = m1 + w;
+	Uint32 *t = m2 + w;
 	int y;
-	for (y = 0; y < screenSize.y; y++)
+	ReadRowPadded(b, src + band->y0 * w, w, lut);
+	for (y = band->y0; y < band->y1; y++)
 	{
-		int x;
-		for (x = 0; x < screenSize.x; x++)
+		Uint32 *d = dest + y * f * dw;
+		Uint32 *tmp = a;
+		a = b;
+		b = tmp;
+		ReadRowPadded(b, src + MIN(y + 1, h - 1) * w, w, lut);
+		switch (f)
 		{
-			int idx = x + y * screenSize.x;
-			color_t color = PixelToColor(&gGraphicsDevice, screen[idx]);
-			color.r = (uint8_t)CLAMP(f * color.r, 0, 255);
-			color.g = (uint8_t)CLAMP(f * color.g, 0, 255);
-			color.b = (uint8_t)CLAMP(f * color.b, 0, 255);
-			screen[idx] = PixelFromColor(&gGraphicsDevice, color);
+		case 4:
+			// Rows, top to bottom: a, (a + c) / 2, c, (c + b) / 2
+			// where c = (a + b) / 2; each with its own horizontal midpoints
+			gBlitRowKernels.AvgRow(v2, a, b, pw);
+			gBlitRowKernels.AvgRow(v1, a, v2, pw);
+			gBlitRowKernels.AvgRow(v3, v2, b, pw);
+			gBlitRowKernels.AvgRow(ma, a, a + 1, w);
+			gBlitRowKernels.AvgRow(mb, b, b + 1, w);
+			gBlitRowKernels.AvgRow(m2, v2, v2 + 1, w);
+			gBlitRowKernels.AvgRow(m1, ma, m2, w);
+			BilinearRow4(d, a, ma, w, t);
+			BilinearRow4(d + dw, v1, m1, w, t);
+			BilinearRow4(d + dw * 2, v2, m2, w, t);
+			gBlitRowKernels.AvgRow(m1, m2, mb, w);
+			BilinearRow4(d + dw * 3, v3, m1, w, t);
+			break;
+		case 3:
+			// Rows: a, (b + 2a) / 3, (a + 2b) / 3
+			gBlitRowKernels.ThirdsRow(v1, b, a, pw);
+			gBlitRowKernels.ThirdsRow(v2, a, b, pw);
+			BilinearRow3(d, a, w, t);
+			BilinearRow3(d + dw, v1, w, t);
+			BilinearRow3(d + dw * 2, v2, w, t);
+			break;
+		case 2:
+			// Rows: a, (a + b) / 2
+			gBlitRowKernels.AvgRow(v1, a, b, pw);
+			BilinearRow2(d, a, w, t);
+			BilinearRow2(d + dw, v1, w, t);
+			break;
+		default:
+			assert(0 && "unsupported scale factor");
+			break;
 		}
 	}
 }
 
-void BlitFlip(GraphicsDevice *device, GraphicsConfig *config)
+// hqx looks at the 3x3 neighbourhood, so a band is scaled along with the
+// source rows just outside it, into scratch, and only its own rows are kept;
+// otherwise its edge rows would see themselves as neighbours like the edges
+// of the frame do
+static void ScaleHQX(const ScaleBand *b)
 {
-	Uint32 *pScreen = (Uint32 *)device->screen->pixels;
-	Vec2i screenSize = Vec2iNew(
-		device->cachedConfig.ResolutionWidth,
-		device->cachedConfig.ResolutionHeight);
-	int scr_size = screenSize.x * screenSize.y;
-	int scalef = config->ScaleFactor;
+	const int w = b->w;
+	const int f = b->f;
+	const int dw = w * f;
+	const int s0 = MAX(0, b->y0 - 1);
+	const int s1 = MIN(b->h, b->y1 + 1);
+	const int isWholeFrame = s0 == b->y0 && s1 == b->y1;
+	Uint32 *scratch = GetScratch(
+		b->scratch,
+		(b->lut != NULL ? (s1 - s0) * w : 0) +
+		(isWholeFrame ? 0 : (s1 - s0) * f * dw));
+	Uint32 *src = b->src + s0 * w;
+	Uint32 *dest = b->dest + b->y0 * f * dw;
+	if (b->lut != NULL)
+	{
+		BrightenRow(scratch, src, (s1 - s0) * w, b->lut);
+		src = scratch;
+		scratch += (s1 - s0) * w;
+	}
+	if (!isWholeFrame)
+	{
+		dest = scratch;
+	}
+	switch (f)
+	{
+	case 2:
+		hq2x_32_rb(src, w * 4, dest, dw * 4, w, s1 - s0);
+		break;
+	case 3:
+		hq3x_32_rb(src, w * 4, dest, dw * 4, w, s1 - s0);
+		break;
+	case 4:
+		hq4x_32_rb(src, w * 4, dest, dw * 4, w, s1 - s0);
+		break;
+	default:
+		assert(0 && "unsupported scale factor");
+		break;
+	}
+	if (!isWholeFrame)
+	{
+		memcpy(
+			b->dest + b->y0 * f * dw,
+			scratch + (b->y0 - s0) * f * dw,
+			(b->y1 - b->y0) * f * dw * sizeof *scratch);
+	}
+}
 
-	ApplyBrightness(device->buf, screenSize, config->Brightness);
+typedef struct
+{
+	Uint32 *dest;
+	Uint32 *src;
+	Vec2i size;
+	int f;
+	ScaleMode mode;
+	const uint8_t *lut;
+	// 0 for one per CPU
+	int bands;
+	const SDL_PixelFormat *format;
+} ScaleJob;
+static void ScaleBandJob(void *data, int band, int bandCount)
+{
+	const ScaleJob *job = data;
+	ScaleBand b;
+	b.dest = job->dest;
+	b.src = job->src;
+	b.w = job->size.x;
+	b.h = job->size.y;
+	b.f = job->f;
+	b.y0 = job->size.y * band / bandCount;
+	b.y1 = job->size.y * (band + 1) / bandCount;
+	b.lut = job->lut;
+	b.scratch = &sScratch[band];
+	if (job->f == 1)
+	{
+		// Only here with brightness, otherwise it's a straight copy
+		BrightenRow(
+			b.dest + b.y0 * b.w, b.src + b.y0 * b.w,
+			(b.y1 - b.y0) * b.w, b.lut);
+	}
+	else if (job->mode == SCALE_MODE_BILINEAR)
+	{
+		ScaleBilinear(&b);
+	}
+	else if (job->mode == SCALE_MODE_HQX)
+	{
+		ScaleHQX(&b);
+	}
+	else
+	{
+		ScaleNearest(&b);
+	}
+}
 
-	if (SDL_LockSurface(device->screen) == -1)
+static int sPoolBands = 1;
+static int GetScaleBandCount(int bands, int h)
+{
+	bands = bands > 0 ? bands : GetCPUCount();
+	bands = CLAMP(bands, 1, h);
+	// One band for each worker and one for this thread; if fewer workers
+	// could be started, the bands are shared out between those that were
+	if (sPoolBands != bands)
 	{
-		printf("Couldn't lock surface; not drawing\n");
-		return;
+		WorkerPoolTerminate(&gWorkerPool);
+		WorkerPoolInit(&gWorkerPool, bands - 1);
+		sPoolBands = bands;
+	}
+	if (bands > sScratchCount)
+	{
+		CREALLOC(sScratch, bands * sizeof *sScratch);
+		memset(
+			sScratch + sScratchCount, 0,
+			(bands - sScratchCount) * sizeof *sScratch);
+		sScratchCount = bands;
+	}
+	return bands;
+}
+
+static int IsSurfaceInternalFormat(const SDL_PixelFormat *fmt)
+{
+	return
+		fmt->BitsPerPixel == 32 &&
+		fmt->Rmask == PIXEL_R_MASK &&
+		fmt->Gmask == PIXEL_G_MASK &&
+		fmt->Bmask == PIXEL_B_MASK;
+}
+// Convert in-place from the internal pixel format to the screen's format
+// Only needed for screens that aren't already ARGB8888
+static void ConvertToSurfaceFormat(
+	Uint32 *pixels, const SDL_PixelFormat *fmt, const int count)
+{
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		color_t c = PixelToColor(pixels[i]);
+		pixels[i] =
+			((Uint32)(c.r >> fmt->Rloss) << fmt->Rshift) |
+			((Uint32)(c.g >> fmt->Gloss) << fmt->Gshift) |
+			((Uint32)(c.b >> fmt->Bloss) << fmt->Bshift) |
+			fmt->Amask;
 	}
+}
 
-	if (scalef == 1)
+static void ScaleJobInit(
+	ScaleJob *job, GraphicsDevice *device, GraphicsConfig *config,
+	Uint32 *src)
+{
+	job->dest = (Uint32 *)device->screen->pixels;
+	job->src = src;
+	job->size = Vec2iNew(
+		device->cachedConfig.ResolutionWidth,
+		device->cachedConfig.ResolutionHeight);
+	// The screen surface was sized for the factor GraphicsInitialize
+	// checked, which is also the one the scalers support
+	job->f = device->cachedConfig.ScaleFactor;
+	job->mode = config->ScaleMode;
+	job->lut = GetBrightnessLUT(config->Brightness);
+	job->bands = config->ScaleBands;
+	job->format = device->screen->format;
+}
+// Scale and convert a frame into the locked screen surface
+static void ScaleJobRun(ScaleJob *job)
+{
+	const int size = job->size.x * job->size.y;
+	if (job->f == 1 && job->lut == NULL)
 	{
-		memcpy(pScreen, device->buf, sizeof *pScreen * scr_size);
+		memcpy(job->dest, job->src, sizeof *job->dest * size);
 	}
-	else if (config->ScaleMode == SCALE_MODE_BILINEAR)
+	else
 	{
-		Bilinear(pScreen, device->buf, screenSize.x, screenSize.y, scalef);
+		WorkerPoolRun(
+			&gWorkerPool, ScaleBandJob, job,
+			GetScaleBandCount(job->bands, job->size.y));
 	}
-	else if (config->ScaleMode == SCALE_MODE_HQX)
+
+	if (!IsSurfaceInternalFormat(job->format))
+	{
+		ConvertToSurfaceFormat(job->dest, job->format, size * job->f * job->f);
+	}
+}
+
+// Pipelined frames: the frame is copied to device->presentBuf and handed to
+// the present thread, which scales it into the screen surface while the
+// main thread carries on with the next frame. The copy leaves buf as drawn,
+// since many screens draw over the last frame.
+// SDL 1.2 video calls must stay on the main thread, so the surface is
+// locked when a frame is handed off, and unlocked and flipped when the next
+// one is, or when flushed.
+typedef struct
+{
+	SDL_Thread *thread;
+	SDL_mutex *lock;
+	// Signalled when a frame is handed off or the thread quits
+	SDL_cond *start;
+	// Signalled when the frame is scaled
+	SDL_cond *done;
+	ScaleJob job;
+	GraphicsDevice *device;
+	// The surface is locked with a frame that hasn't been flipped
+	int isPending;
+	int isBusy;
+	int quit;
+} Presenter;
+static Presenter sPresenter;
+
+static int PresentThread(void *data)
+{
+	Presenter *p = data;
+	SDL_LockMutex(p->lock);
+	for (;;)
 	{
-		switch (scalef)
+		while (!p->isBusy && !p->quit)
+		{
+			SDL_CondWait(p->start, p->lock);
+		}
+		if (p->quit)
 		{
-		case 2:
-			hq2x_32(device->buf, pScreen, screenSize.x, screenSize.y);
-			break;
-		case 3:
-			hq3x_32(device->buf, pScreen, screenSize.x, screenSize.y);
-			break;
-		case 4:
-			hq4x_32(device->buf, pScreen, screenSize.x, screenSize.y);
-			break;
-		default:
-			assert(0);
 			break;
 		}
+		SDL_UnlockMutex(p->lock);
+		ScaleJobRun(&p->job);
+		SDL_LockMutex(p->lock);
+		p->isBusy = 0;
+		SDL_CondSignal(p->done);
 	}
-	else
+	SDL_UnlockMutex(p->lock);
+	return 0;
+}
+
+static int PresenterStart(Presenter *p)
+{
+	if (p->thread != NULL)
+	{
+		return 1;
+	}
+	p->lock = SDL_CreateMutex();
+	p->start = SDL_CreateCond();
+	p->done = SDL_CreateCond();
+	p->thread = SDL_CreateThread(PresentThread, p);
+	if (p->thread == NULL)
+	{
+		printf("Cannot create present thread: %s\n", SDL_GetError());
+		SDL_DestroyCond(p->start);
+		SDL_DestroyCond(p->done);
+		SDL_DestroyMutex(p->lock);
+		memset(p, 0, sizeof *p);
+		return 0;
+	}
+	return 1;
+}
+
+void BlitFlipFlush(void)
+{
+	Presenter *p = &sPresenter;
+	if (!p->isPending)
+	{
+		return;
+	}
+	SDL_LockMutex(p->lock);
+	while (p->isBusy)
+	{
+		SDL_CondWait(p->done, p->lock);
+	}
+	SDL_UnlockMutex(p->lock);
+	SDL_UnlockSurface(p->device->screen);
+	SDL_Flip(p->device->screen);
+	p->isPending = 0;
+}
+
+void BlitFlipAsync(GraphicsDevice *device, GraphicsConfig *config)
+{
+	Presenter *p = &sPresenter;
+	if (!config->PipelinedPresent || !PresenterStart(p))
+	{
+		BlitFlip(device, config);
+		return;
+	}
+
+	BlitFlipFlush();
+
+	if (SDL_LockSurface(device->screen) == -1)
+	{
+		printf("Couldn't lock surface; not drawing\n");
+		return;
+	}
+	memcpy(
+		device->presentBuf, device->buf,
+		GraphicsGetMemSize(&device->cachedConfig));
+	SDL_LockMutex(p->lock);
+	ScaleJobInit(&p->job, device, config, device->presentBuf);
+	p->device = device;
+	p->isPending = 1;
+	p->isBusy = 1;
+	SDL_CondSignal(p->start);
+	SDL_UnlockMutex(p->lock);
+}
+
+void BlitFlip(GraphicsDevice *device, GraphicsConfig *config)
+{
+	ScaleJob job;
+
+	BlitFlipFlush();
+
+	if (SDL_LockSurface(device->screen) == -1)
 	{
-		Scale8(pScreen, device->buf, screenSize.x, screenSize.y, scalef);
+		printf("Couldn't lock surface; not drawing\n");
+		return;
 	}
 
+	ScaleJobInit(&job, device, config, device->buf);
+	ScaleJobRun(&job);
+
 	SDL_UnlockSurface(device->screen);
 	SDL_Flip(device->screen);
 }
+
+void BlitTerminate(void)
+{
+	Presenter *p = &sPresenter;
+	int i;
+	BlitFlipFlush();
+	if (p->thread != NULL)
+	{
+		SDL_LockMutex(p->lock);
+		p->quit = 1;
+		SDL_CondSignal(p->start);
+		SDL_UnlockMutex(p->lock);
+		SDL_WaitThread(p->thread, NULL);
+		SDL_DestroyCond(p->start);
+		SDL_DestroyCond(p->done);
+		SDL_DestroyMutex(p->lock);
+		memset(p, 0, sizeof *p);
+	}
+	WorkerPoolTerminate(&gWorkerPool);
+	sPoolBands = 1;
+	for (i = 0; i < sScratchCount; i++)
+	{
+		CFREE(sScratch[i].data);
+	}
+	CFREE(sScratch);
+	sScratchCount = 0;
+}
@@ -56,30 +56,56 @@
 #include "pic_file.h"
 #include "vector.h"
 
-color_t PixelToColor(GraphicsDevice *device, Uint32 pixel);
-Uint32 PixelFromColor(GraphicsDevice *device, color_t color);
-
 #define BLIT_TRANSPARENT 1
 #define BLIT_BACKGROUND 2
 
-void Blit(int x, int y, PicPaletted *pic, void *table, int mode);
-void BlitBackground(int x, int y, PicPaletted *pic, HSV *tint, int mode);
+void Blit(
+	GraphicsDevice *device, int x, int y, PicPaletted *pic, void *table,
+	int mode);
+void BlitBackground(
+	GraphicsDevice *device, int x, int y, PicPaletted *pic, HSV *tint,
+	int mode);
 void BlitMasked(
 	GraphicsDevice *device,
 	Pic *pic,
 	Vec2i pos,
 	color_t mask,
 	int isTransparent);
+// Opaque blit of pixels already in the framebuffer format; a row copy
+// stride is the distance between rows of pixels
+void BlitPixels(
+	GraphicsDevice *device, const Uint32 *pixels, int stride,
+	Vec2i size, Vec2i pos);
+// Fill a rectangle with a framebuffer pixel
+void BlitFill(GraphicsDevice *device, Vec2i size, Vec2i pos, Uint32 pixel);
+// Transparent blits using the pics' compiled RLE runs
+// Whole runs are clipped and copied, skipping transparent pixels for free
+void BlitRLE(
+	GraphicsDevice *device, int x, int y, const PicPaletted *pic,
+	const Uint32 *lut);
+void BlitRLEBackground(
+	GraphicsDevice *device, int x, int y, const PicPaletted *pic, HSV *tint);
+void BlitRLEMasked(
+	GraphicsDevice *device, const Pic *pic, Vec2i pos, color_t mask);
+// Copy the runs of pixels already in the framebuffer format
+void BlitRLEPixels(
+	GraphicsDevice *device, const Uint32 *pixels, const PicRLE *rle,
+	Vec2i size, Vec2i pos);
+// For devices that are measuring blits: grow the measured bounds by the
+// rectangle of size at pos, clipped, and return 1 so the blit is skipped
+// Returns 0 for other devices. Called first by each blit.
+int BlitMeasure(GraphicsDevice *device, Vec2i pos, Vec2i size);
 /* DrawPic - simply draws a rectangular picture to screen. I do not
  * remember if this is the one that ignores zero source-pixels or not, but
  * that much should be obvious.
  */
-#define DrawPic(x, y, pic) (Blit(x, y, pic, NULL, 0))
+#define DrawPic(device, x, y, pic) (Blit(device, x, y, pic, NULL, 0))
 /* 
  * DrawTPic - I think the T here stands for transparent, ie ignore zero
  * source pixels when copying data.
  */
-#define DrawTPic(x, y, pic) (Blit(x, y, pic, NULL, BLIT_TRANSPARENT))
+#define DrawTPic(device, x, y, pic)\
+	(Blit(device, x, y, pic, NULL, BLIT_TRANSPARENT))
 /*
  * DrawTTPic - I think this stands for translated transparent. What this
  * does is that for each source pixel that would be copied it will first
@@ -87,7 +113,8 @@ void BlitMasked(
  * that you can provide a 256 byte table to change any or all colors of
  * the source image. This feature is used heavily in the game.
  */
-#define DrawTTPic(x, y, pic, table) (Blit(x, y, pic, table, BLIT_TRANSPARENT))
+#define DrawTTPic(device, x, y, pic, table)\
+	(Blit(device, x, y, pic, table, BLIT_TRANSPARENT))
 /* 
  * DrawBTPic - I think the B stands for background here. If I remember
  * correctly this one uses the sourc eimage only as a mask. If a pixel in
@@ -95,9 +122,19 @@ void BlitMasked(
  * translate that value through the table and put it back. This is used to
  * do the "invisible" guys as well as the gas clouds.
  */
-#define DrawBTPic(x, y, pic, tint) (BlitBackground(x, y, pic, tint, BLIT_TRANSPARENT | BLIT_BACKGROUND))
+#define DrawBTPic(device, x, y, pic, tint)\
+	(BlitBackground(\
+		device, x, y, pic, tint, BLIT_TRANSPARENT | BLIT_BACKGROUND))
 
 void BlitFlip(GraphicsDevice *device, GraphicsConfig *config);
+// Like BlitFlip, but the frame is scaled on the present thread while the
+// caller draws the next one, and shown when the next one is handed off
+// Falls back to BlitFlip if Graphics.PipelinedPresent is off
+void BlitFlipAsync(GraphicsDevice *device, GraphicsConfig *config);
+// Wait for and show the frame handed off by BlitFlipAsync, if any
+void BlitFlipFlush(void);
+// Stop the present thread and worker pool, and free the scaler scratch
+void BlitTerminate(void);
 
 #define BLIT_BRIGHTNESS_MIN (-10)
 #define BLIT_BRIGHTNESS_MAX 10
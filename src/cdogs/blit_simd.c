@@ -0,0 +1,541 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "blit_simd.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define BLIT_SIMD_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#define TARGET(_isa) __attribute__((target(_isa)))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define BLIT_SIMD_X86
+#include <intrin.h>
+#include <immintrin.h>
+#define TARGET(_isa)
+#endif
+
+
+// Scalar kernels; these define the results the SIMD kernels must match
+
+static void MaskedRowScalar(
+	uint32_t *dst, const color_t *src, int n, color_t mask)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		dst[i] = PixelFromColor(ColorMult(src[i], mask));
+	}
+}
+static void MaskedRowTransparentScalar(
+	uint32_t *dst, const color_t *src, int n, color_t mask)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		if (!ColorEquals(src[i], colorBlack))
+		{
+			dst[i] = PixelFromColor(ColorMult(src[i], mask));
+		}
+	}
+}
+static void OpaqueMaskRowScalar(
+	unsigned char *isOpaque, const color_t *src, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		isOpaque[i] = (unsigned char)!ColorEquals(src[i], colorBlack);
+	}
+}
+static void AvgRowScalar(
+	uint32_t *dst, const uint32_t *a, const uint32_t *b, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		// Per-byte truncating average, without carries between bytes
+		dst[i] = (a[i] & b[i]) + (((a[i] ^ b[i]) >> 1) & 0x7F7F7F7F);
+	}
+}
+static void ThirdsRowScalar(
+	uint32_t *dst, const uint32_t *a, const uint32_t *b, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		uint32_t p = 0;
+		int shift;
+		for (shift = 0; shift < 32; shift += 8)
+		{
+			const uint32_t x = (a[i] >> shift) & 0xFF;
+			const uint32_t y = (b[i] >> shift) & 0xFF;
+			p |= ((x + 2 * y) / 3) << shift;
+		}
+		dst[i] = p;
+	}
+}
+static void InterleaveRowScalar(
+	uint32_t *dst, const uint32_t **rows, int f, int n)
+{
+	int i;
+	for (i = 0; i < n; i++)
+	{
+		int k;
+		for (k = 0; k < f; k++)
+		{
+			dst[i * f + k] = rows[k][i];
+		}
+	}
+}
+
+
+#ifdef BLIT_SIMD_X86
+
+// The SIMD kernels work on 16-bit lanes, one colour channel per lane.
+// ColorMult's c * m / 255 is computed exactly without a divide as
+// (x + 1 + ((x + 1) >> 8)) >> 8, which holds for all x = c * m <= 255 * 255.
+// Pixels are then reordered from r,g,b,a (color_t) to b,g,r,0 (the internal
+// ARGB8888 framebuffer format, little endian) with word shuffles; the mask's
+// alpha lane is 0 so the alpha byte comes out clear.
+// Black is tested on the r,g,b bytes only, like ColorEquals.
+#define RGB_BYTES_MASK 0x00FFFFFF
+#define BGRA_SHUFFLE _MM_SHUFFLE(3, 0, 1, 2)
+
+TARGET("sse2")
+static __m128i MaskedPixelsSSE2(__m128i px, __m128i m)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	__m128i lo = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpacklo_epi8(px, zero), m), one);
+	__m128i hi = _mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpackhi_epi8(px, zero), m), one);
+	lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+	lo = _mm_shufflehi_epi16(
+		_mm_shufflelo_epi16(lo, BGRA_SHUFFLE), BGRA_SHUFFLE);
+	hi = _mm_shufflehi_epi16(
+		_mm_shufflelo_epi16(hi, BGRA_SHUFFLE), BGRA_SHUFFLE);
+	return _mm_packus_epi16(lo, hi);
+}
+TARGET("sse2")
+static void MaskedRowSSE2(
+	uint32_t *dst, const color_t *src, int n, color_t mask)
+{
+	const __m128i m = _mm_set_epi16(
+		0, mask.b, mask.g, mask.r, 0, mask.b, mask.g, mask.r);
+	int i;
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		const __m128i px = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), MaskedPixelsSSE2(px, m));
+	}
+	MaskedRowScalar(dst + i, src + i, n - i, mask);
+}
+TARGET("sse2")
+static void MaskedRowTransparentSSE2(
+	uint32_t *dst, const color_t *src, int n, color_t mask)
+{
+	const __m128i m = _mm_set_epi16(
+		0, mask.b, mask.g, mask.r, 0, mask.b, mask.g, mask.r);
+	const __m128i rgb = _mm_set1_epi32(RGB_BYTES_MASK);
+	int i;
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		const __m128i px = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i old = _mm_loadu_si128((const __m128i *)(dst + i));
+		const __m128i isBlack = _mm_cmpeq_epi32(
+			_mm_and_si128(px, rgb), _mm_setzero_si128());
+		const __m128i out = _mm_or_si128(
+			_mm_and_si128(isBlack, old),
+			_mm_andnot_si128(isBlack, MaskedPixelsSSE2(px, m)));
+		_mm_storeu_si128((__m128i *)(dst + i), out);
+	}
+	MaskedRowTransparentScalar(dst + i, src + i, n - i, mask);
+}
+TARGET("sse2")
+static void OpaqueMaskRowSSE2(
+	unsigned char *isOpaque, const color_t *src, int n)
+{
+	const __m128i rgb = _mm_set1_epi32(RGB_BYTES_MASK);
+	const __m128i zero = _mm_setzero_si128();
+	int i;
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		const __m128i px = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i isBlack = _mm_cmpeq_epi32(_mm_and_si128(px, rgb), zero);
+		// One bit per pixel, from the top bit of each 32-bit lane
+		const int blackBits = _mm_movemask_ps(_mm_castsi128_ps(isBlack));
+		int j;
+		for (j = 0; j < 4; j++)
+		{
+			isOpaque[i + j] = (unsigned char)!((blackBits >> j) & 1);
+		}
+	}
+	OpaqueMaskRowScalar(isOpaque + i, src + i, n - i);
+}
+
+// Scaler kernels: the average uses the same carry-free form as the scalar
+// kernel, and the divide by 3 of at most 3 * 255 is (x * 0x5556) >> 16
+#define AVG_LOW_BITS 0x7F7F7F7F
+#define DIV3_MUL 0x5556
+
+TARGET("sse2")
+static void AvgRowSSE2(
+	uint32_t *dst, const uint32_t *a, const uint32_t *b, int n)
+{
+	const __m128i low = _mm_set1_epi32(AVG_LOW_BITS);
+	int i;
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		const __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+		const __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+		_mm_storeu_si128(
+			(__m128i *)(dst + i),
+			_mm_add_epi8(
+				_mm_and_si128(x, y),
+				_mm_and_si128(_mm_srli_epi32(_mm_xor_si128(x, y), 1), low)));
+	}
+	AvgRowScalar(dst + i, a + i, b + i, n - i);
+}
+TARGET("sse2")
+static void ThirdsRowSSE2(
+	uint32_t *dst, const uint32_t *a, const uint32_t *b, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i div3 = _mm_set1_epi16((short)DIV3_MUL);
+	int i;
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		const __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+		const __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+		__m128i lo = _mm_unpacklo_epi8(y, zero);
+		__m128i hi = _mm_unpackhi_epi8(y, zero);
+		lo = _mm_add_epi16(_mm_add_epi16(lo, lo), _mm_unpacklo_epi8(x, zero));
+		hi = _mm_add_epi16(_mm_add_epi16(hi, hi), _mm_unpackhi_epi8(x, zero));
+		_mm_storeu_si128(
+			(__m128i *)(dst + i),
+			_mm_packus_epi16(
+				_mm_mulhi_epu16(lo, div3), _mm_mulhi_epu16(hi, div3)));
+	}
+	ThirdsRowScalar(dst + i, a + i, b + i, n - i);
+}
+// Only 2 and 4 are vectorised; AVX2 uses this too, since its unpacks work
+// within 128-bit lanes and would need extra permutes
+TARGET("sse2")
+static void InterleaveRowSSE2(
+	uint32_t *dst, const uint32_t **rows, int f, int n)
+{
+	int i = 0;
+	if (f == 2)
+	{
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128i r0 = _mm_loadu_si128((const __m128i *)(rows[0] + i));
+			const __m128i r1 = _mm_loadu_si128((const __m128i *)(rows[1] + i));
+			_mm_storeu_si128(
+				(__m128i *)(dst + i * 2), _mm_unpacklo_epi32(r0, r1));
+			_mm_storeu_si128(
+				(__m128i *)(dst + i * 2 + 4), _mm_unpackhi_epi32(r0, r1));
+		}
+	}
+	else if (f == 4)
+	{
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128i r0 = _mm_loadu_si128((const __m128i *)(rows[0] + i));
+			const __m128i r1 = _mm_loadu_si128((const __m128i *)(rows[1] + i));
+			const __m128i r2 = _mm_loadu_si128((const __m128i *)(rows[2] + i));
+			const __m128i r3 = _mm_loadu_si128((const __m128i *)(rows[3] + i));
+			const __m128i lo01 = _mm_unpacklo_epi32(r0, r1);
+			const __m128i lo23 = _mm_unpacklo_epi32(r2, r3);
+			const __m128i hi01 = _mm_unpackhi_epi32(r0, r1);
+			const __m128i hi23 = _mm_unpackhi_epi32(r2, r3);
+			_mm_storeu_si128(
+				(__m128i *)(dst + i * 4), _mm_unpacklo_epi64(lo01, lo23));
+			_mm_storeu_si128(
+				(__m128i *)(dst + i * 4 + 4), _mm_unpackhi_epi64(lo01, lo23));
+			_mm_storeu_si128(
+				(__m128i *)(dst + i * 4 + 8), _mm_unpacklo_epi64(hi01, hi23));
+			_mm_storeu_si128(
+				(__m128i *)(dst + i * 4 + 12), _mm_unpackhi_epi64(hi01, hi23));
+		}
+	}
+	{
+		const uint32_t *rest[4];
+		int k;
+		for (k = 0; k < f; k++)
+		{
+			rest[k] = rows[k] + i;
+		}
+		InterleaveRowScalar(dst + i * f, rest, f, n - i);
+	}
+}
+
+TARGET("avx2")
+static __m256i MaskedPixelsAVX2(__m256i px, __m256i m)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi16(1);
+	__m256i lo = _mm256_add_epi16(
+		_mm256_mullo_epi16(_mm256_unpacklo_epi8(px, zero), m), one);
+	__m256i hi = _mm256_add_epi16(
+		_mm256_mullo_epi16(_mm256_unpackhi_epi8(px, zero), m), one);
+	lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+	hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+	lo = _mm256_shufflehi_epi16(
+		_mm256_shufflelo_epi16(lo, BGRA_SHUFFLE), BGRA_SHUFFLE);
+	hi = _mm256_shufflehi_epi16(
+		_mm256_shufflelo_epi16(hi, BGRA_SHUFFLE), BGRA_SHUFFLE);
+	// Unpack and pack both work within 128-bit lanes, so pixel order is kept
+	return _mm256_packus_epi16(lo, hi);
+}
+TARGET("avx2")
+static __m256i MaskVectorAVX2(color_t mask)
+{
+	return _mm256_set_epi16(
+		0, mask.b, mask.g, mask.r, 0, mask.b, mask.g, mask.r,
+		0, mask.b, mask.g, mask.r, 0, mask.b, mask.g, mask.r);
+}
+TARGET("avx2")
+static void MaskedRowAVX2(
+	uint32_t *dst, const color_t *src, int n, color_t mask)
+{
+	const __m256i m = MaskVectorAVX2(mask);
+	int i;
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		const __m256i px = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), MaskedPixelsAVX2(px, m));
+	}
+	MaskedRowScalar(dst + i, src + i, n - i, mask);
+}
+TARGET("avx2")
+static void MaskedRowTransparentAVX2(
+	uint32_t *dst, const color_t *src, int n, color_t mask)
+{
+	const __m256i m = MaskVectorAVX2(mask);
+	const __m256i rgb = _mm256_set1_epi32(RGB_BYTES_MASK);
+	int i;
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		const __m256i px = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i old = _mm256_loadu_si256((const __m256i *)(dst + i));
+		const __m256i isBlack = _mm256_cmpeq_epi32(
+			_mm256_and_si256(px, rgb), _mm256_setzero_si256());
+		_mm256_storeu_si256(
+			(__m256i *)(dst + i),
+			_mm256_blendv_epi8(MaskedPixelsAVX2(px, m), old, isBlack));
+	}
+	MaskedRowTransparentScalar(dst + i, src + i, n - i, mask);
+}
+TARGET("avx2")
+static void OpaqueMaskRowAVX2(
+	unsigned char *isOpaque, const color_t *src, int n)
+{
+	const __m256i rgb = _mm256_set1_epi32(RGB_BYTES_MASK);
+	int i;
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		const __m256i px = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i isBlack = _mm256_cmpeq_epi32(
+			_mm256_and_si256(px, rgb), _mm256_setzero_si256());
+		// One bit per pixel, from the top bit of each 32-bit lane
+		const int blackBits = _mm256_movemask_ps(_mm256_castsi256_ps(isBlack));
+		int j;
+		for (j = 0; j < 8; j++)
+		{
+			isOpaque[i + j] = (unsigned char)!((blackBits >> j) & 1);
+		}
+	}
+	OpaqueMaskRowScalar(isOpaque + i, src + i, n - i);
+}
+
+TARGET("avx2")
+static void AvgRowAVX2(
+	uint32_t *dst, const uint32_t *a, const uint32_t *b, int n)
+{
+	const __m256i low = _mm256_set1_epi32(AVG_LOW_BITS);
+	int i;
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+		const __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+		_mm256_storeu_si256(
+			(__m256i *)(dst + i),
+			_mm256_add_epi8(
+				_mm256_and_si256(x, y),
+				_mm256_and_si256(
+					_mm256_srli_epi32(_mm256_xor_si256(x, y), 1), low)));
+	}
+	AvgRowScalar(dst + i, a + i, b + i, n - i);
+}
+TARGET("avx2")
+static void ThirdsRowAVX2(
+	uint32_t *dst, const uint32_t *a, const uint32_t *b, int n)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i div3 = _mm256_set1_epi16((short)DIV3_MUL);
+	int i;
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+		const __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+		__m256i lo = _mm256_unpacklo_epi8(y, zero);
+		__m256i hi = _mm256_unpackhi_epi8(y, zero);
+		lo = _mm256_add_epi16(
+			_mm256_add_epi16(lo, lo), _mm256_unpacklo_epi8(x, zero));
+		hi = _mm256_add_epi16(
+			_mm256_add_epi16(hi, hi), _mm256_unpackhi_epi8(x, zero));
+		// Unpack and pack both work within 128-bit lanes, so order is kept
+		_mm256_storeu_si256(
+			(__m256i *)(dst + i),
+			_mm256_packus_epi16(
+				_mm256_mulhi_epu16(lo, div3), _mm256_mulhi_epu16(hi, div3)));
+	}
+	ThirdsRowScalar(dst + i, a + i, b + i, n - i);
+}
+
+static void CPUID(unsigned int leaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+	__cpuidex((int *)regs, (int)leaf, 0);
+#else
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+// Whether the OS saves the SSE and AVX registers on context switches
+static int IsAVXStateEnabled(void)
+{
+	unsigned int eax;
+#ifdef _MSC_VER
+	eax = (unsigned int)_xgetbv(0);
+#else
+	unsigned int edx;
+	__asm__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+#endif
+	return (eax & 6) == 6;
+}
+#endif
+
+BlitSIMD BlitSIMDDetect(void)
+{
+#ifdef BLIT_SIMD_X86
+	unsigned int regs[4];
+	unsigned int maxLeaf;
+	BlitSIMD simd = BLIT_SIMD_NONE;
+	CPUID(0, regs);
+	maxLeaf = regs[0];
+	if (maxLeaf < 1)
+	{
+		return simd;
+	}
+	CPUID(1, regs);
+	// EDX bit 26: SSE2
+	if (regs[3] & (1u << 26))
+	{
+		simd = BLIT_SIMD_SSE2;
+	}
+	// ECX bit 27: OSXSAVE, bit 28: AVX; then leaf 7 EBX bit 5: AVX2
+	if ((regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) &&
+		IsAVXStateEnabled() && maxLeaf >= 7)
+	{
+		CPUID(7, regs);
+		if (regs[1] & (1u << 5))
+		{
+			simd = BLIT_SIMD_AVX2;
+		}
+	}
+	return simd;
+#else
+	return BLIT_SIMD_NONE;
+#endif
+}
+
+const char *BlitSIMDStr(BlitSIMD simd)
+{
+	switch (simd)
+	{
+	case BLIT_SIMD_NONE:
+		return "none";
+	case BLIT_SIMD_SSE2:
+		return "SSE2";
+	case BLIT_SIMD_AVX2:
+		return "AVX2";
+	default:
+		return "";
+	}
+}
+
+int BlitRowKernelsGet(BlitRowKernels *kernels, BlitSIMD simd)
+{
+	switch (simd)
+	{
+	case BLIT_SIMD_NONE:
+		kernels->MaskedRow = MaskedRowScalar;
+		kernels->MaskedRowTransparent = MaskedRowTransparentScalar;
+		kernels->OpaqueMaskRow = OpaqueMaskRowScalar;
+		kernels->AvgRow = AvgRowScalar;
+		kernels->ThirdsRow = ThirdsRowScalar;
+		kernels->InterleaveRow = InterleaveRowScalar;
+		return 1;
+#ifdef BLIT_SIMD_X86
+	case BLIT_SIMD_SSE2:
+		kernels->MaskedRow = MaskedRowSSE2;
+		kernels->MaskedRowTransparent = MaskedRowTransparentSSE2;
+		kernels->OpaqueMaskRow = OpaqueMaskRowSSE2;
+		kernels->AvgRow = AvgRowSSE2;
+		kernels->ThirdsRow = ThirdsRowSSE2;
+		kernels->InterleaveRow = InterleaveRowSSE2;
+		return 1;
+	case BLIT_SIMD_AVX2:
+		kernels->MaskedRow = MaskedRowAVX2;
+		kernels->MaskedRowTransparent = MaskedRowTransparentAVX2;
+		kernels->OpaqueMaskRow = OpaqueMaskRowAVX2;
+		kernels->AvgRow = AvgRowAVX2;
+		kernels->ThirdsRow = ThirdsRowAVX2;
+		kernels->InterleaveRow = InterleaveRowSSE2;
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+// Start with the scalar kernels, so they're usable before init
+BlitRowKernels gBlitRowKernels =
+{
+	MaskedRowScalar, MaskedRowTransparentScalar, OpaqueMaskRowScalar,
+	AvgRowScalar, ThirdsRowScalar, InterleaveRowScalar
+};
+
+void BlitRowKernelsInit(void)
+{
+	BlitRowKernelsGet(&gBlitRowKernels, BlitSIMDDetect());
+}
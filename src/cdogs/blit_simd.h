@@ -0,0 +1,79 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __BLIT_SIMD
+#define __BLIT_SIMD
+
+#include <stdint.h>
+
+#include "color.h"
+
+// Row kernels for the hot per-pixel blit loops
+// Each kernel has a scalar version and, on x86, SSE2 and AVX2 versions,
+// which are bit-exact with the scalar ones.
+// The best version supported by the CPU is picked once at startup.
+
+typedef enum
+{
+	BLIT_SIMD_NONE,
+	BLIT_SIMD_SSE2,
+	BLIT_SIMD_AVX2,
+	BLIT_SIMD_COUNT
+} BlitSIMD;
+
+typedef struct
+{
+	// dst[i] = PixelFromColor(ColorMult(src[i], mask))
+	void (*MaskedRow)(uint32_t *dst, const color_t *src, int n, color_t mask);
+	// As MaskedRow, but black (transparent) source pixels are skipped
+	void (*MaskedRowTransparent)(
+		uint32_t *dst, const color_t *src, int n, color_t mask);
+	// isOpaque[i] = !ColorEquals(src[i], colorBlack)
+	void (*OpaqueMaskRow)(unsigned char *isOpaque, const color_t *src, int n);
+
+	// Kernels for the scalers, on framebuffer pixels, per byte:
+	// dst[i] = (a[i] + b[i]) / 2
+	void (*AvgRow)(uint32_t *dst, const uint32_t *a, const uint32_t *b, int n);
+	// dst[i] = (a[i] + 2 * b[i]) / 3
+	void (*ThirdsRow)(
+		uint32_t *dst, const uint32_t *a, const uint32_t *b, int n);
+	// dst[i * f + k] = rows[k][i], for k < f <= 4
+	void (*InterleaveRow)(uint32_t *dst, const uint32_t **rows, int f, int n);
+} BlitRowKernels;
+
+extern BlitRowKernels gBlitRowKernels;
+
+// Best SIMD level supported by both this build and the CPU
+BlitSIMD BlitSIMDDetect(void);
+const char *BlitSIMDStr(BlitSIMD simd);
+// Get the kernels for a SIMD level; returns 0 if they're not available
+int BlitRowKernelsGet(BlitRowKernels *kernels, BlitSIMD simd);
+// Set gBlitRowKernels to the fastest available kernels
+void BlitRowKernelsInit(void);
+
+#endif
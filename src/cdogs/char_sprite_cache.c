@@ -0,0 +1,338 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "char_sprite_cache.h"
+
+#include <string.h>
+
+#include "blit.h"
+#include "palette.h"
+#include "pic.h"
+#include "pic_manager.h"
+#include "utils.h"
+
+// Power of two
+#define CHAR_SPRITE_BUCKETS 256
+
+CharSpriteCache gCharSpriteCache =
+{
+	NULL, NULL, NULL, 0, 0, 1024 * 1024, 0, 0, 0, NULL
+};
+
+
+// Keys are normalised by CharSpriteCacheDraw, so absent layers have zero
+// offsets and all fields can be compared
+static int KeyEquals(const CharSpriteKey *a, const CharSpriteKey *b)
+{
+	int i;
+	if (a->table != b->table)
+	{
+		return 0;
+	}
+	for (i = 0; i < CHAR_SPRITE_LAYERS; i++)
+	{
+		if (a->layers[i].picIndex != b->layers[i].picIndex ||
+			a->layers[i].dx != b->layers[i].dx ||
+			a->layers[i].dy != b->layers[i].dy)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+static CharSprite **Bucket(CharSpriteCache *c, const CharSpriteKey *key)
+{
+	size_t h = (size_t)key->table >> 8;
+	int i;
+	for (i = 0; i < CHAR_SPRITE_LAYERS; i++)
+	{
+		h = h * 31 + (size_t)key->layers[i].picIndex;
+		h = h * 31 + (size_t)(key->layers[i].dx & 0xff);
+		h = h * 31 + (size_t)(key->layers[i].dy & 0xff);
+	}
+	h *= 2654435761u;
+	return &c->buckets[(h >> 8) & (CHAR_SPRITE_BUCKETS - 1)];
+}
+
+static void ListRemove(CharSpriteCache *c, CharSprite *s)
+{
+	if (s->prev != NULL)
+	{
+		s->prev->next = s->next;
+	}
+	else
+	{
+		c->head = s->next;
+	}
+	if (s->next != NULL)
+	{
+		s->next->prev = s->prev;
+	}
+	else
+	{
+		c->tail = s->prev;
+	}
+}
+static void ListPushFront(CharSpriteCache *c, CharSprite *s)
+{
+	s->prev = NULL;
+	s->next = c->head;
+	if (c->head != NULL)
+	{
+		c->head->prev = s;
+	}
+	else
+	{
+		c->tail = s;
+	}
+	c->head = s;
+}
+
+static void SpriteDelete(CharSprite *s)
+{
+	CFREE(s->pixels);
+	PicRLEFree(s->rle);
+	CFREE(s);
+}
+
+// Take the sprite out of the cache; it is deleted once no thread is
+// blitting it
+static void SpriteFree(CharSpriteCache *c, CharSprite *s)
+{
+	CharSprite **b = Bucket(c, &s->key);
+	while (*b != s)
+	{
+		b = &(*b)->hashNext;
+	}
+	*b = s->hashNext;
+	ListRemove(c, s);
+	c->bytes -= s->bytes;
+	c->count--;
+	if (s->pins > 0)
+	{
+		s->isEvicted = 1;
+	}
+	else
+	{
+		SpriteDelete(s);
+	}
+}
+
+// Evict least recently used sprites until within budget, keeping the newest
+static void Evict(CharSpriteCache *c)
+{
+	while (c->bytes > c->budget && c->tail != c->head)
+	{
+		SpriteFree(c, c->tail);
+	}
+}
+
+// Composite the layers in order, as the equivalent transparent Blits would
+static CharSprite *SpriteNew(const CharSpriteKey *key)
+{
+	const Uint32 *lut = key->table != NULL ?
+		PaletteGetTranslationLUT(key->table) : PaletteGetLUT();
+	PicPaletted *pics[CHAR_SPRITE_LAYERS];
+	int left = 0, top = 0, right = 0, bottom = 0;
+	int isFirst = 1;
+	unsigned char *isOpaque;
+	CharSprite *s;
+	int i;
+	for (i = 0; i < CHAR_SPRITE_LAYERS; i++)
+	{
+		const TOffsetPic *l = &key->layers[i];
+		pics[i] = l->picIndex >= 0 ?
+			PicManagerGetOldPic(&gPicManager, l->picIndex) : NULL;
+		if (pics[i] == NULL)
+		{
+			continue;
+		}
+		if (isFirst)
+		{
+			left = l->dx;
+			top = l->dy;
+			right = l->dx + pics[i]->w;
+			bottom = l->dy + pics[i]->h;
+			isFirst = 0;
+		}
+		else
+		{
+			left = MIN(left, l->dx);
+			top = MIN(top, l->dy);
+			right = MAX(right, l->dx + pics[i]->w);
+			bottom = MAX(bottom, l->dy + pics[i]->h);
+		}
+	}
+
+	CCALLOC(s, sizeof *s);
+	s->key = *key;
+	s->offset = Vec2iNew(left, top);
+	s->size = Vec2iNew(right - left, bottom - top);
+	CCALLOC(s->pixels, MAX(1, s->size.x * s->size.y) * sizeof *s->pixels);
+	CCALLOC(isOpaque, MAX(1, s->size.x * s->size.y));
+	for (i = 0; i < CHAR_SPRITE_LAYERS; i++)
+	{
+		const PicPaletted *pic = pics[i];
+		int x, y;
+		if (pic == NULL)
+		{
+			continue;
+		}
+		for (y = 0; y < pic->h; y++)
+		{
+			const int offset =
+				(key->layers[i].dy - top + y) * s->size.x +
+				key->layers[i].dx - left;
+			const unsigned char *row = pic->data + y * pic->w;
+			for (x = 0; x < pic->w; x++)
+			{
+				if (row[x] != 0)
+				{
+					s->pixels[offset + x] = lut[row[x]];
+					isOpaque[offset + x] = 1;
+				}
+			}
+		}
+	}
+	s->rle = PicRLEFromMask(isOpaque, s->size.x, s->size.y);
+	CFREE(isOpaque);
+	s->bytes = sizeof *s +
+		s->size.x * s->size.y * (sizeof *s->pixels) +
+		(s->size.y + 1) * sizeof *s->rle->rowStarts +
+		(s->rle->rowStarts[s->size.y]) * sizeof *s->rle->runs;
+	return s;
+}
+
+static CharSprite *Get(CharSpriteCache *c, const CharSpriteKey *key)
+{
+	CharSprite **b;
+	CharSprite *s;
+	if (c->buckets == NULL)
+	{
+		CCALLOC(c->buckets, CHAR_SPRITE_BUCKETS * sizeof *c->buckets);
+	}
+	// Composited pixels are only valid for the palette they were made with
+	if (c->generation != PaletteGetLUTGeneration())
+	{
+		while (c->head != NULL)
+		{
+			SpriteFree(c, c->head);
+		}
+		c->generation = PaletteGetLUTGeneration();
+	}
+	b = Bucket(c, key);
+	for (s = *b; s != NULL; s = s->hashNext)
+	{
+		if (KeyEquals(&s->key, key))
+		{
+			c->hits++;
+			if (s != c->head)
+			{
+				ListRemove(c, s);
+				ListPushFront(c, s);
+			}
+			return s;
+		}
+	}
+	c->misses++;
+	s = SpriteNew(key);
+	s->hashNext = *b;
+	*b = s;
+	ListPushFront(c, s);
+	c->bytes += s->bytes;
+	c->count++;
+	Evict(c);
+	return s;
+}
+
+void CharSpriteCacheInit(CharSpriteCache *c, size_t budget)
+{
+	c->lock = SDL_CreateMutex();
+	CharSpriteCacheSetBudget(c, budget);
+}
+void CharSpriteCacheTerminate(CharSpriteCache *c)
+{
+	CharSpriteCacheClear(c);
+	SDL_DestroyMutex(c->lock);
+	c->lock = NULL;
+}
+
+void CharSpriteCacheSetBudget(CharSpriteCache *c, size_t budget)
+{
+	c->budget = budget;
+	Evict(c);
+}
+
+void CharSpriteCacheDraw(
+	CharSpriteCache *c, GraphicsDevice *device, const CharSpriteKey *key,
+	Vec2i pos)
+{
+	CharSpriteKey k = *key;
+	CharSprite *s;
+	int i;
+	for (i = 0; i < CHAR_SPRITE_LAYERS; i++)
+	{
+		if (k.layers[i].picIndex < 0)
+		{
+			k.layers[i].dx = 0;
+			k.layers[i].dy = 0;
+		}
+	}
+	// Only held for the lookup; the sprite is pinned while blitting so that
+	// a miss on another thread can't free it
+	SDL_LockMutex(c->lock);
+	s = Get(c, &k);
+	s->pins++;
+	SDL_UnlockMutex(c->lock);
+	BlitRLEPixels(
+		device, s->pixels, s->rle, s->size, Vec2iAdd(pos, s->offset));
+	SDL_LockMutex(c->lock);
+	s->pins--;
+	if (s->pins == 0 && s->isEvicted)
+	{
+		SpriteDelete(s);
+	}
+	SDL_UnlockMutex(c->lock);
+}
+
+void CharSpriteCacheClear(CharSpriteCache *c)
+{
+	if (c->hits + c->misses > 0)
+	{
+		debug(D_NORMAL, "character sprites: %d hits, %d misses, %d cached\n",
+			c->hits, c->misses, c->count);
+	}
+	while (c->head != NULL)
+	{
+		SpriteFree(c, c->head);
+	}
+	CFREE(c->buckets);
+	c->buckets = NULL;
+	c->hits = 0;
+	c->misses = 0;
+}
@@ -0,0 +1,106 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __CHAR_SPRITE_CACHE
+#define __CHAR_SPRITE_CACHE
+
+#include <stddef.h>
+
+#include <SDL_mutex.h>
+
+#include "grafx.h"
+#include "pic_file.h"
+#include "vector.h"
+
+// LRU cache of composited character sprites.
+// A character is drawn as up to three translated layers (body, head, gun);
+// each distinct combination is composited once into framebuffer pixels with
+// compiled opaque runs, so drawing it again is a single RLE blit.
+// The layers' pics and offsets already encode body type, face, direction,
+// state and gun, and the table encodes the character's colours and status
+// effect, so (table, layers) is the key.
+// Entries are evicted least recently used first once the total pixel memory
+// exceeds the budget; everything is dropped when the palette changes.
+// Drawing locks the cache for the lookup, so viewports on other threads can
+// draw with it; sprites being blitted are pinned against eviction.
+
+#define CHAR_SPRITE_LAYERS 3
+
+typedef struct
+{
+	const TranslationTable *table;
+	// Layers in drawing order; picIndex < 0 for absent layers
+	TOffsetPic layers[CHAR_SPRITE_LAYERS];
+} CharSpriteKey;
+
+typedef struct CharSprite
+{
+	CharSpriteKey key;
+	// Top-left relative to the drawing position
+	Vec2i offset;
+	Vec2i size;
+	Uint32 *pixels;
+	PicRLE *rle;
+	size_t bytes;
+	// Number of threads blitting the sprite
+	int pins;
+	// Taken out of the cache while pinned; deleted when unpinned
+	int isEvicted;
+	// LRU list, most recently used first
+	struct CharSprite *prev;
+	struct CharSprite *next;
+	struct CharSprite *hashNext;
+} CharSprite;
+
+typedef struct
+{
+	CharSprite **buckets;
+	CharSprite *head;
+	CharSprite *tail;
+	int count;
+	size_t bytes;
+	size_t budget;
+	int generation;
+	int hits;
+	int misses;
+	SDL_mutex *lock;
+} CharSpriteCache;
+
+extern CharSpriteCache gCharSpriteCache;
+
+// Budget in bytes
+void CharSpriteCacheInit(CharSpriteCache *c, size_t budget);
+void CharSpriteCacheTerminate(CharSpriteCache *c);
+// Evicts entries if already over the budget
+void CharSpriteCacheSetBudget(CharSpriteCache *c, size_t budget);
+void CharSpriteCacheDraw(
+	CharSpriteCache *c, GraphicsDevice *device, const CharSpriteKey *key,
+	Vec2i pos);
+void CharSpriteCacheClear(CharSpriteCache *c);
+
+#endif
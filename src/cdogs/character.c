@@ -31,6 +31,7 @@
 #include <assert.h>
 
 #include "actors.h"
+#include "palette.h"
 
 // Color range defines
 #define SKIN_START 2
@@ -85,6 +86,7 @@ void SetCharacterColors(TranslationTable *t, CharLooks looks)
 	SetShade(t, LEGS_START, LEGS_END, looks.leg);
 	SetShade(t, SKIN_START, SKIN_END, looks.skin);
 	SetShade(t, HAIR_START, HAIR_END, looks.hair);
+	PaletteInvalidateLUTs();
 }
 
 void CharacterSetLooks(Character *c, const CharLooks *l)
@@ -133,6 +135,8 @@ Character *CharacterStoreInsertOther(CharacterStore *store, int idx)
 		memcpy(
 			&store->others[i], &store->others[i - 1], sizeof store->others[i]);
 	}
+	// Tables have moved
+	PaletteInvalidateLUTs();
 	store->otherCount++;
 	return &store->others[idx];
 }
@@ -152,6 +156,8 @@ void CharacterStoreDeleteOther(CharacterStore *store, int idx)
 			&store->others[i + 1],
 			sizeof store->others[i]);
 	}
+	// Tables have moved
+	PaletteInvalidateLUTs();
 }
 
 void CharacterStoreAddPrisoner(CharacterStore *store, int character)
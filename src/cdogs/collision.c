@@ -48,8 +48,12 @@
 */
 #include "collision.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "actors.h"
 #include "config.h"
+#include "tile_item_index.h"
 
 CollisionTeam CalcCollisionTeam(int isActor, TActor *actor)
 {
@@ -69,18 +73,11 @@ CollisionTeam CalcCollisionTeam(int isActor, TActor *actor)
 
 int IsCollisionWithWall(Vec2i pos, Vec2i size)
 {
-	if (HitWall(pos.x - size.x,	pos.y - size.y) ||
-		HitWall(pos.x - size.x,	pos.y) ||
-		HitWall(pos.x - size.x,	pos.y + size.y) ||
-		HitWall(pos.x,			pos.y + size.y) ||
-		HitWall(pos.x + size.x,	pos.y + size.y) ||
-		HitWall(pos.x + size.x,	pos.y) ||
-		HitWall(pos.x + size.x,	pos.y - size.y) ||
-		HitWall(pos.x,			pos.y - size.y))
-	{
-		return 1;
-	}
-	return 0;
+	// Test all the tiles the box touches at once
+	return MapBitsAny(
+		&gMapNoWalk,
+		Vec2iNew((pos.x - size.x) / TILE_WIDTH, (pos.y - size.y) / TILE_HEIGHT),
+		Vec2iNew((pos.x + size.x) / TILE_WIDTH, (pos.y + size.y) / TILE_HEIGHT));
 }
 
 int ItemsCollide(TTileItem *item1, TTileItem *item2, Vec2i pos)
@@ -103,20 +100,36 @@ int ItemsCollide(TTileItem *item1, TTileItem *item2, Vec2i pos)
 	return 0;
 }
 
-static int IsOnSameTeam(TTileItem *i, CollisionTeam team)
+// As ItemsCollide, but with the index's copy of the second item
+static int ItemCollidesWithEntry(
+	const TTileItem *item, const TileItemEntry *e, Vec2i pos)
 {
-	if (gConfig.Game.AllyCollision != ALLYCOLLISION_NORMAL)
+	int dx = abs(pos.x - e->x);
+	int dy = abs(pos.y - e->y);
+	int rx = item->w + e->w;
+	int ry = item->h + e->h;
+
+	if (dx < rx && dy < ry)
 	{
-		CollisionTeam itemTeam = COLLISIONTEAM_NONE;
-		if (i->kind == KIND_CHARACTER)
+		int odx = abs(item->x - e->x);
+		int ody = abs(item->y - e->y);
+
+		if (dx <= odx || dy <= ody)
 		{
-			TActor *a = i->actor;
-			itemTeam = CalcCollisionTeam(1, a);
+			return 1;
 		}
+	}
+	return 0;
+}
+
+static int IsOnSameTeam(const TileItemEntry *e, CollisionTeam team)
+{
+	if (gConfig.Game.AllyCollision != ALLYCOLLISION_NORMAL)
+	{
 		return
 			team != COLLISIONTEAM_NONE &&
-			itemTeam != COLLISIONTEAM_NONE &&
-			team == itemTeam;
+			e->team != COLLISIONTEAM_NONE &&
+			team == (CollisionTeam)e->team;
 	}
 	return 0;
 }
@@ -138,23 +151,708 @@ TTileItem *GetItemOnTileInCollision(
 		int dx;
 		for (dx = -1; dx <= 1; dx++)
 		{
-			TTileItem *i = Map(tx + dx, ty + dy).things;
-			while (i)
+			const TileItemCell *cell = TileItemIndexGetCell(tx + dx, ty + dy);
+			int i;
+			// Newest first
+			for (i = cell->count - 1; i >= 0; i--)
 			{
+				const TileItemEntry *e = &cell->entries[i];
 				// Don't collide if items are on the same team
-				if (!IsOnSameTeam(i, team))
+				if (!IsOnSameTeam(e, team) &&
+					item != e->item &&
+					(e->flags & mask) &&
+					ItemCollidesWithEntry(item, e, pos))
+				{
+					return e->item;
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+// Whether an indexed item is found before another at the same point or
+// sweep time: in tile row then column order, newest first, which is the
+// order GetItemOnTileInCollision scans the cells in
+static int IsFoundBefore(const TTileItem *a, const TTileItem *b)
+{
+	if (a->cell != b->cell)
+	{
+		return a->cell < b->cell;
+	}
+	return a->slot > b->slot;
+}
+
+#define FULL_TILE_WIDTH		(TILE_WIDTH * 256)
+#define FULL_TILE_HEIGHT	(TILE_HEIGHT * 256)
+
+// Time, as a fraction of the move, that a moving coordinate first reaches
+// the inclusive range lo to hi, and the time it leaves it
+// Returns 0 if it never does
+static int GetSlabTimes(
+	int start, int delta, int lo, int hi, double *enter, double *exit)
+{
+	double t1, t2;
+	if (delta == 0)
+	{
+		*enter = -1;
+		*exit = 2;
+		return start >= lo && start <= hi;
+	}
+	t1 = (double)(lo - start) / delta;
+	t2 = (double)(hi - start) / delta;
+	*enter = MIN(t1, t2);
+	*exit = MAX(t1, t2);
+	return 1;
+}
+
+// When a point moving from from to to first collides with an item in the
+// index, as a fraction of the move, or -1 if it doesn't
+// Items the point starts inside are only hit if the point isn't leaving,
+// as with ItemsCollide.
+static double SweepEntry(
+	const TTileItem *item, const TileItemEntry *e, Vec2i from, Vec2i to)
+{
+	// The pixel positions that collide, as an inclusive full coordinate box
+	const int rx = item->w + e->w;
+	const int ry = item->h + e->h;
+	const Vec2i lo = Vec2iNew((e->x - rx + 1) * 256, (e->y - ry + 1) * 256);
+	const Vec2i hi = Vec2iNew((e->x + rx) * 256 - 1, (e->y + ry) * 256 - 1);
+	double enterX, exitX, enterY, exitY;
+	double enter, exit;
+	if (!GetSlabTimes(from.x, to.x - from.x, lo.x, hi.x, &enterX, &exitX) ||
+		!GetSlabTimes(from.y, to.y - from.y, lo.y, hi.y, &enterY, &exitY))
+	{
+		return -1;
+	}
+	enter = MAX(enterX, enterY);
+	exit = MIN(exitX, exitY);
+	if (enter > exit || enter > 1 || exit < 0)
+	{
+		return -1;
+	}
+	if (enter <= 0)
+	{
+		return ItemCollidesWithEntry(item, e, Vec2iScaleDiv(to, 256)) ? 0 : -1;
+	}
+	return enter;
+}
+
+// A sweep added to the collision batch, and the items it could hit
+typedef struct
+{
+	TTileItem *item;
+	// Pixel box of the positions the move can reach, grown by the item's
+	// size and a pixel of rounding, so that it covers every item the item
+	// could touch on the way
+	Vec2i min, max;
+	int mask;
+	// Range of the sweep's candidates in sCandidates
+	int candidateStart;
+	int candidateCount;
+} BatchSweep;
+
+// An item the batch's sweeps could hit, found once however many sweeps
+// are near it
+typedef struct
+{
+	// NULL once removed from the map
+	TTileItem *item;
+	Vec2i min, max;
+	int order;
+} BatchItem;
+
+typedef struct
+{
+	int sweep;
+	int item;
+} BatchPair;
+
+static int sIsBatching = 0;
+// Items the batch's sweeps can hit
+static int sMask = 0;
+// Set once a shootable item is added or moved after the candidates were
+// gathered; the sweeps then fall back to the unbatched tests
+static int sIsStale = 0;
+static BatchSweep *sSweeps = NULL;
+static int sSweepsCount = 0;
+static int sSweepsSize = 0;
+static BatchItem *sItems = NULL;
+static int sItemsCount = 0;
+static int sItemsSize = 0;
+static BatchPair *sPairs = NULL;
+static int sPairsCount = 0;
+static int sPairsSize = 0;
+// Item indices of the batch's candidates, grouped by sweep
+static int *sCandidates = NULL;
+static int sCandidatesSize = 0;
+// Index orders used by the sort and sweep
+static int *sSweepOrder = NULL;
+static int *sActiveSweeps = NULL;
+static int *sActiveItems = NULL;
+static int sScratchSize = 0;
+// Tiles whose items have been gathered, by batch stamp
+static unsigned int sTileStamps[YMAX][XMAX];
+static unsigned int sStamp = 0;
+
+// Grow an array to fit one more than count elements
+#define BATCH_GROW(_array, _count, _size)\
+	if ((_count) == (_size))\
+	{\
+		(_size) = (_size) == 0 ? 64 : (_size) * 2;\
+		CREALLOC((_array), (_size) * sizeof *(_array));\
+	}
+
+// Move an item as in SweepForCollision; items are tested from the sweep's
+// candidates in the batch if given, instead of from the index
+static CollisionSweep Sweep(
+	TTileItem *item, Vec2i from, Vec2i to, int mask, CollisionTeam team,
+	CollisionFilter filter, void *filterData, const BatchSweep *batch)
+{
+	CollisionSweep result;
+	const Vec2i delta = Vec2iNew(to.x - from.x, to.y - from.y);
+	const Vec2i step = Vec2iNew(
+		delta.x > 0 ? 1 : (delta.x < 0 ? -1 : 0),
+		delta.y > 0 ? 1 : (delta.y < 0 ? -1 : 0));
+	Vec2i tile = Vec2iNew(from.x / FULL_TILE_WIDTH, from.y / FULL_TILE_HEIGHT);
+	Vec2i lastTile = Vec2iNew(-2, -2);
+	// Times, as fractions of the move, at which the next tile is entered on
+	// each axis
+	// Coordinates are whole, so moving left or up enters the next tile at
+	// one less than this tile's edge
+	double tNextX = 2, tNextY = 2;
+	// When the current tile was entered, and along which axis
+	double tEntered = 0;
+	int enteredAxis = -1;
+	double tItem = 2;
+	result.item = NULL;
+	result.isWall = 0;
+	if (batch != NULL)
+	{
+		int i;
+		for (i = 0; i < batch->candidateCount; i++)
+		{
+			const TTileItem *t =
+				sItems[sCandidates[batch->candidateStart + i]].item;
+			const TileItemEntry *e =
+				t != NULL ? TileItemIndexGetEntry(t) : NULL;
+			double tEnter;
+			if (e == NULL ||
+				IsOnSameTeam(e, team) ||
+				item == e->item ||
+				!(e->flags & mask))
+			{
+				continue;
+			}
+			tEnter = SweepEntry(item, e, from, to);
+			if (tEnter >= 0 &&
+				(tEnter < tItem || (tEnter == tItem &&
+				IsFoundBefore(e->item, result.item))) &&
+				(filter == NULL || filter(e->item, filterData)))
+			{
+				tItem = tEnter;
+				result.item = e->item;
+			}
+		}
+	}
+	if (step.x != 0)
+	{
+		const int edge = step.x > 0 ?
+			(tile.x + 1) * FULL_TILE_WIDTH : tile.x * FULL_TILE_WIDTH - 1;
+		tNextX = (double)(edge - from.x) / delta.x;
+	}
+	if (step.y != 0)
+	{
+		const int edge = step.y > 0 ?
+			(tile.y + 1) * FULL_TILE_HEIGHT : tile.y * FULL_TILE_HEIGHT - 1;
+		tNextY = (double)(edge - from.y) / delta.y;
+	}
+	for (;;)
+	{
+		// Check the items on and around this tile; the 3x3 blocks of
+		// consecutive tiles overlap, so skip what was already checked
+		int dy;
+		for (dy = -1; batch == NULL && mask != 0 && dy <= 1; dy++)
+		{
+			int dx;
+			for (dx = -1; dx <= 1; dx++)
+			{
+				const Vec2i t = Vec2iNew(tile.x + dx, tile.y + dy);
+				const TileItemCell *cell;
+				int i;
+				if (abs(t.x - lastTile.x) <= 1 && abs(t.y - lastTile.y) <= 1)
 				{
-					if (item != i &&
-					(i->flags & mask) &&
-					ItemsCollide(item, i, pos))
+					continue;
+				}
+				cell = TileItemIndexGetCell(t.x, t.y);
+				for (i = cell->count - 1; i >= 0; i--)
+				{
+					const TileItemEntry *e = &cell->entries[i];
+					double tEnter;
+					if (IsOnSameTeam(e, team) ||
+						item == e->item ||
+						!(e->flags & mask))
+					{
+						continue;
+					}
+					tEnter = SweepEntry(item, e, from, to);
+					if (tEnter >= 0 &&
+						(tEnter < tItem || (tEnter == tItem &&
+						IsFoundBefore(e->item, result.item))) &&
+						(filter == NULL || filter(e->item, filterData)))
 					{
-						return i;
+						tItem = tEnter;
+						result.item = e->item;
 					}
 				}
-				i = i->next;
 			}
 		}
+		if (MapBitsGet(&gMapNoWalk, tile.x, tile.y))
+		{
+			// Items in the way are hit before the wall
+			if (result.item == NULL || tItem > tEntered)
+			{
+				result.item = NULL;
+				result.isWall = 1;
+			}
+			break;
+		}
+		// Step into whichever tile is entered next, unless that is past
+		// the end of the move, or after an item has already been hit
+		lastTile = tile;
+		if (MIN(tNextX, tNextY) > MIN(tItem, 1))
+		{
+			break;
+		}
+		if (tNextX <= tNextY)
+		{
+			tEntered = tNextX;
+			enteredAxis = 0;
+			tNextX += (double)FULL_TILE_WIDTH / abs(delta.x);
+			tile.x += step.x;
+		}
+		else
+		{
+			tEntered = tNextY;
+			enteredAxis = 1;
+			tNextY += (double)FULL_TILE_HEIGHT / abs(delta.y);
+			tile.y += step.y;
+		}
+	}
+	if (result.isWall)
+	{
+		// Stop just short of the wall; the coordinate along the axis the
+		// wall was entered on is its edge, which rounding the time could
+		// put a unit further back
+		result.pos = Vec2iNew(
+			from.x + (int)(delta.x * tEntered),
+			from.y + (int)(delta.y * tEntered));
+		if (enteredAxis == 0)
+		{
+			result.pos.x = step.x > 0 ?
+				tile.x * FULL_TILE_WIDTH - 1 : (tile.x + 1) * FULL_TILE_WIDTH;
+		}
+		else if (enteredAxis == 1)
+		{
+			result.pos.y = step.y > 0 ?
+				tile.y * FULL_TILE_HEIGHT - 1 :
+				(tile.y + 1) * FULL_TILE_HEIGHT;
+		}
+	}
+	else if (result.item != NULL)
+	{
+		result.pos = Vec2iNew(
+			from.x + (int)(delta.x * tItem), from.y + (int)(delta.y * tItem));
+		// Items that reach into walls may be hit right on the wall's edge,
+		// which rounding can put just inside the wall; keep out of it
+		if (MapBitsGet(
+			&gMapNoWalk,
+			result.pos.x / FULL_TILE_WIDTH, result.pos.y / FULL_TILE_HEIGHT))
+		{
+			result.pos.x -= step.x;
+			result.pos.y -= step.y;
+		}
+	}
+	else
+	{
+		result.pos = to;
 	}
+	return result;
+}
 
-	return NULL;
+CollisionSweep SweepForCollision(
+	TTileItem *item, Vec2i from, Vec2i to, int mask, CollisionTeam team,
+	CollisionFilter filter, void *filterData)
+{
+	return Sweep(item, from, to, mask, team, filter, filterData, NULL);
+}
+
+void CollisionBatchTerminate(void)
+{
+	CFREE(sSweeps);
+	sSweeps = NULL;
+	sSweepsCount = sSweepsSize = 0;
+	CFREE(sItems);
+	sItems = NULL;
+	sItemsCount = sItemsSize = 0;
+	CFREE(sPairs);
+	sPairs = NULL;
+	sPairsCount = sPairsSize = 0;
+	CFREE(sCandidates);
+	sCandidates = NULL;
+	sCandidatesSize = 0;
+	CFREE(sSweepOrder);
+	CFREE(sActiveSweeps);
+	CFREE(sActiveItems);
+	sSweepOrder = sActiveSweeps = sActiveItems = NULL;
+	sScratchSize = 0;
+	sIsBatching = 0;
+}
+
+void CollisionBatchBegin(void)
+{
+	sSweepsCount = 0;
+	sItemsCount = 0;
+	sPairsCount = 0;
+	sMask = 0;
+	sIsStale = 0;
+	sIsBatching = 1;
+}
+
+// The pixel box of the positions an item can reach moving from one full
+// coordinate position to another
+static void GetSweepBox(
+	const TTileItem *item, Vec2i from, Vec2i to, Vec2i *min, Vec2i *max)
+{
+	*min = Vec2iNew(
+		MIN(from.x, to.x) / 256 - item->w - 1,
+		MIN(from.y, to.y) / 256 - item->h - 1);
+	*max = Vec2iNew(
+		MAX(from.x, to.x) / 256 + item->w + 1,
+		MAX(from.y, to.y) / 256 + item->h + 1);
+}
+
+int CollisionBatchAdd(TTileItem *item, Vec2i from, Vec2i to, int mask)
+{
+	BatchSweep *s;
+	if (!sIsBatching || mask == 0)
+	{
+		return -1;
+	}
+	BATCH_GROW(sSweeps, sSweepsCount, sSweepsSize);
+	s = &sSweeps[sSweepsCount];
+	s->item = item;
+	GetSweepBox(item, from, to, &s->min, &s->max);
+	s->mask = mask;
+	s->candidateStart = 0;
+	s->candidateCount = 0;
+	sMask |= mask;
+	return sSweepsCount++;
+}
+
+// Gather the items on the tiles around a sweep, skipping the tiles that
+// earlier sweeps have gathered
+static void GatherItems(const BatchSweep *s, int mask)
+{
+	// Items are in the cell of their centre, and reach at most into the
+	// next tile, as GetItemOnTileInCollision assumes
+	const int x0 = MAX(0, s->min.x / TILE_WIDTH - 1);
+	const int y0 = MAX(0, s->min.y / TILE_HEIGHT - 1);
+	const int x1 = MIN(XMAX - 1, s->max.x / TILE_WIDTH + 1);
+	const int y1 = MIN(YMAX - 1, s->max.y / TILE_HEIGHT + 1);
+	int x, y;
+	for (y = y0; y <= y1; y++)
+	{
+		for (x = x0; x <= x1; x++)
+		{
+			const TileItemCell *cell;
+			int i;
+			if (sTileStamps[y][x] == sStamp)
+			{
+				continue;
+			}
+			sTileStamps[y][x] = sStamp;
+			cell = TileItemIndexGetCell(x, y);
+			for (i = 0; i < cell->count; i++)
+			{
+				const TileItemEntry *e = &cell->entries[i];
+				BatchItem *b;
+				if (!(e->flags & mask))
+				{
+					continue;
+				}
+				BATCH_GROW(sItems, sItemsCount, sItemsSize);
+				b = &sItems[sItemsCount];
+				b->item = e->item;
+				b->min = Vec2iNew(e->x - e->w, e->y - e->h);
+				b->max = Vec2iNew(e->x + e->w, e->y + e->h);
+				b->order = sItemsCount;
+				sItemsCount++;
+			}
+		}
+	}
+}
+
+static int CompareItems(const void *v1, const void *v2)
+{
+	const BatchItem *i1 = v1;
+	const BatchItem *i2 = v2;
+	if (i1->min.x != i2->min.x)
+	{
+		return i1->min.x < i2->min.x ? -1 : 1;
+	}
+	return i1->order - i2->order;
+}
+
+static int CompareSweepOrder(const void *v1, const void *v2)
+{
+	const BatchSweep *s1 = &sSweeps[*(const int *)v1];
+	const BatchSweep *s2 = &sSweeps[*(const int *)v2];
+	if (s1->min.x != s2->min.x)
+	{
+		return s1->min.x < s2->min.x ? -1 : 1;
+	}
+	return *(const int *)v1 - *(const int *)v2;
+}
+
+static int ComparePairs(const void *v1, const void *v2)
+{
+	const BatchPair *p1 = v1;
+	const BatchPair *p2 = v2;
+	if (p1->sweep != p2->sweep)
+	{
+		return p1->sweep - p2->sweep;
+	}
+	return p1->item - p2->item;
+}
+
+static void AddPair(int sweep, int item)
+{
+	const BatchSweep *s = &sSweeps[sweep];
+	const BatchItem *b = &sItems[item];
+	if (s->min.y > b->max.y || b->min.y > s->max.y)
+	{
+		return;
+	}
+	BATCH_GROW(sPairs, sPairsCount, sPairsSize);
+	sPairs[sPairsCount].sweep = sweep;
+	sPairs[sPairsCount].item = item;
+	sPairsCount++;
+}
+
+// Keep only the active boxes whose right edge reaches x
+static int PruneSweeps(int *active, int count, int x)
+{
+	int i, kept = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (sSweeps[active[i]].max.x >= x)
+		{
+			active[kept++] = active[i];
+		}
+	}
+	return kept;
+}
+
+static int PruneItems(int *active, int count, int x)
+{
+	int i, kept = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (sItems[active[i]].max.x >= x)
+		{
+			active[kept++] = active[i];
+		}
+	}
+	return kept;
+}
+
+void CollisionBatchFindCandidates(void)
+{
+	int i, j;
+	int activeSweeps = 0, activeItems = 0;
+	if (!sIsBatching || sSweepsCount == 0)
+	{
+		return;
+	}
+
+	// Gather each tile's shootable items once for the whole batch
+	sStamp++;
+	if (sStamp == 0)
+	{
+		memset(sTileStamps, 0, sizeof sTileStamps);
+		sStamp = 1;
+	}
+	for (i = 0; i < sSweepsCount; i++)
+	{
+		GatherItems(&sSweeps[i], sMask);
+	}
+	if (sItemsCount == 0)
+	{
+		return;
+	}
+
+	// Sort and sweep along x: when a box starts, it overlaps on x exactly
+	// the boxes of the other kind that started before it and haven't ended
+	if (sScratchSize < MAX(sSweepsCount, sItemsCount))
+	{
+		sScratchSize = MAX(sSweepsCount, sItemsCount);
+		CREALLOC(sSweepOrder, sScratchSize * sizeof *sSweepOrder);
+		CREALLOC(sActiveSweeps, sScratchSize * sizeof *sActiveSweeps);
+		CREALLOC(sActiveItems, sScratchSize * sizeof *sActiveItems);
+	}
+	qsort(sItems, sItemsCount, sizeof *sItems, CompareItems);
+	for (i = 0; i < sSweepsCount; i++)
+	{
+		sSweepOrder[i] = i;
+	}
+	qsort(sSweepOrder, sSweepsCount, sizeof *sSweepOrder, CompareSweepOrder);
+	i = 0;
+	j = 0;
+	while (i < sSweepsCount || j < sItemsCount)
+	{
+		if (j == sItemsCount ||
+			(i < sSweepsCount &&
+			sSweeps[sSweepOrder[i]].min.x <= sItems[j].min.x))
+		{
+			const int s = sSweepOrder[i];
+			int k;
+			activeItems = PruneItems(
+				sActiveItems, activeItems, sSweeps[s].min.x);
+			for (k = 0; k < activeItems; k++)
+			{
+				AddPair(s, sActiveItems[k]);
+			}
+			sActiveSweeps[activeSweeps++] = s;
+			i++;
+		}
+		else
+		{
+			int k;
+			activeSweeps = PruneSweeps(
+				sActiveSweeps, activeSweeps, sItems[j].min.x);
+			for (k = 0; k < activeSweeps; k++)
+			{
+				AddPair(sActiveSweeps[k], j);
+			}
+			sActiveItems[activeItems++] = j;
+			j++;
+		}
+	}
+
+	// Group the candidates by sweep, in item order, so that each sweep
+	// tests them in the same order whatever order they were found in
+	qsort(sPairs, sPairsCount, sizeof *sPairs, ComparePairs);
+	if (sCandidatesSize < sPairsCount)
+	{
+		sCandidatesSize = sPairsCount;
+		CREALLOC(sCandidates, sCandidatesSize * sizeof *sCandidates);
+	}
+	for (i = 0; i < sPairsCount; i++)
+	{
+		BatchSweep *s = &sSweeps[sPairs[i].sweep];
+		if (s->candidateCount == 0)
+		{
+			s->candidateStart = i;
+		}
+		s->candidateCount++;
+		sCandidates[i] = sPairs[i].item;
+	}
+}
+
+// The batch's sweep, if the move is within it and for items it gathered
+static const BatchSweep *GetBatchSweep(
+	int index, const TTileItem *item, Vec2i from, Vec2i to, int mask)
+{
+	const BatchSweep *s;
+	Vec2i min, max;
+	if (!sIsBatching || sIsStale || index < 0 || index >= sSweepsCount)
+	{
+		return NULL;
+	}
+	s = &sSweeps[index];
+	GetSweepBox(item, from, to, &min, &max);
+	if (s->item != item || (mask & ~s->mask) ||
+		min.x < s->min.x || min.y < s->min.y ||
+		max.x > s->max.x || max.y > s->max.y)
+	{
+		return NULL;
+	}
+	return s;
+}
+
+CollisionSweep CollisionBatchSweep(
+	int index,
+	TTileItem *item, Vec2i from, Vec2i to, int mask, CollisionTeam team,
+	CollisionFilter filter, void *filterData)
+{
+	return Sweep(
+		item, from, to, mask, team, filter, filterData,
+		GetBatchSweep(index, item, from, to, mask));
+}
+
+TTileItem *CollisionBatchGetItem(
+	int index, TTileItem *item, Vec2i pos, int mask, CollisionTeam team)
+{
+	const Vec2i full = Vec2iScale(pos, 256);
+	const BatchSweep *s = GetBatchSweep(index, item, full, full, mask);
+	int tx = pos.x / TILE_WIDTH;
+	int ty = pos.y / TILE_HEIGHT;
+	TTileItem *found = NULL;
+	int i;
+	if (s == NULL)
+	{
+		return GetItemOnTileInCollision(item, pos, mask, team);
+	}
+	if (tx == 0 || ty == 0 || tx >= XMAX - 1 || ty >= YMAX - 1)
+	{
+		return NULL;
+	}
+	// Candidates are in batch order; return the item the unbatched scan
+	// would find first
+	for (i = 0; i < s->candidateCount; i++)
+	{
+		const TTileItem *t = sItems[sCandidates[s->candidateStart + i]].item;
+		const TileItemEntry *e = t != NULL ? TileItemIndexGetEntry(t) : NULL;
+		if (e != NULL &&
+			!IsOnSameTeam(e, team) &&
+			item != e->item &&
+			(e->flags & mask) &&
+			ItemCollidesWithEntry(item, e, pos) &&
+			(found == NULL || IsFoundBefore(e->item, found)))
+		{
+			found = e->item;
+		}
+	}
+	return found;
+}
+
+void CollisionBatchRemoveItem(const TTileItem *item)
+{
+	int i;
+	if (!sIsBatching)
+	{
+		return;
+	}
+	for (i = 0; i < sItemsCount; i++)
+	{
+		if (sItems[i].item == item)
+		{
+			sItems[i].item = NULL;
+		}
+	}
+}
+
+void CollisionBatchMoveItem(const TTileItem *item)
+{
+	if (sIsBatching && (item->flags & sMask))
+	{
+		sIsStale = 1;
+	}
+}
+
+void CollisionBatchEnd(void)
+{
+	sIsBatching = 0;
 }
@@ -52,7 +52,7 @@
 #include "actors.h"
 #include "map.h"
 
-#define HitWall(x, y) (gMap[(y)/TILE_HEIGHT][(x)/TILE_WIDTH].flags & MAPTILE_NO_WALK)
+#define HitWall(x, y) MapBitsGet(&gMapNoWalk, (x)/TILE_WIDTH, (y)/TILE_HEIGHT)
 
 // Which "team" the actor's on, for collision
 // Actors on the same team don't have to collide
@@ -69,4 +69,60 @@ int IsCollisionWithWall(Vec2i pos, Vec2i size);
 TTileItem *GetItemOnTileInCollision(
 	TTileItem *item, Vec2i pos, int mask, CollisionTeam team);
 
+// What a moving item runs into first
+typedef struct
+{
+	// Where the item stops, in full coordinates: just short of the wall,
+	// at the item it hit, or at the end of the move if it hit nothing
+	Vec2i pos;
+	// The item hit, or NULL
+	TTileItem *item;
+	int isWall;
+} CollisionSweep;
+
+// Whether a moving item can hit another, for items it would otherwise pass
+// through
+typedef int (*CollisionFilter)(const TTileItem *target, void *data);
+
+// Move an item, treated as a point against walls, along the segment from
+// one position to another in full coordinates, walking every tile it
+// crosses, so fast or long moves can't pass through thin walls or items.
+// Items are hit as by GetItemOnTileInCollision, but anywhere on the way,
+// and only if filter, if given, allows it. Of the items reached first,
+// the one GetItemOnTileInCollision would find first is hit.
+CollisionSweep SweepForCollision(
+	TTileItem *item, Vec2i from, Vec2i to, int mask, CollisionTeam team,
+	CollisionFilter filter, void *filterData);
+
+// Batch of sweeps made together, such as by all the mobile objects in a
+// tick, that finds the items each could hit in one broadphase pass instead
+// of each sweep scanning the tiles around it.
+// Add the sweeps' moves, find the candidates, then make the sweeps with
+// CollisionBatchSweep or CollisionBatchGetItem, in any order. Damage done
+// in between is seen by later sweeps, as items are tested as they are now.
+// Moves outside the added move, or sweeps not in the batch (index -1),
+// fall back to the unbatched tests. So do all sweeps once an item they
+// could hit is added to or moved on the map, as it may not be among the
+// candidates.
+// Items whose flags become hittable mid-batch without moving are missed;
+// damage only ever makes items unhittable (wrecks).
+void CollisionBatchTerminate(void);
+void CollisionBatchBegin(void);
+// Returns the sweep's index in the batch, or -1 if it isn't batched
+int CollisionBatchAdd(TTileItem *item, Vec2i from, Vec2i to, int mask);
+void CollisionBatchFindCandidates(void);
+CollisionSweep CollisionBatchSweep(
+	int index,
+	TTileItem *item, Vec2i from, Vec2i to, int mask, CollisionTeam team,
+	CollisionFilter filter, void *filterData);
+// As GetItemOnTileInCollision, including which item is found when several
+// collide
+TTileItem *CollisionBatchGetItem(
+	int index, TTileItem *item, Vec2i pos, int mask, CollisionTeam team);
+// Forget an item removed from the map while batching
+void CollisionBatchRemoveItem(const TTileItem *item);
+// Note an item added to or moved on the map while batching
+void CollisionBatchMoveItem(const TTileItem *item);
+void CollisionBatchEnd(void);
+
 #endif
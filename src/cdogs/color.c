@@ -28,7 +28,9 @@
 */
 #include "color.h"
 
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "utils.h"
 
@@ -40,6 +42,7 @@ color_t colorBlack = { 0, 0, 0, 255 };
 color_t colorDarker = { 192, 192, 192, 255 };
 color_t colorPurple = { 192, 0, 192, 255 };
 color_t colorGray = { 128, 128, 128, 255 };
+color_t colorFog = { 96, 96, 96, 255 };
 
 color_t ColorMult(color_t c, color_t m)
 {
@@ -147,6 +150,153 @@ color_t ColorTint(color_t c, HSV hsv)
 	return out;
 }
 
+// Huge values are clamped, so that products of fixed point values and
+// components can't overflow
+#define TINT_FIXED_MAX 65536.0
+static int64_t ToFixed(double x)
+{
+	x = CLAMP(x, -TINT_FIXED_MAX, TINT_FIXED_MAX);
+	return (int64_t)floor(x * TINT_FIXED_ONE + 0.5);
+}
+
+void TintFixedInit(TintFixed *t, HSV hsv)
+{
+	memset(t, 0, sizeof *t);
+	t->v = ToFixed(hsv.v);
+	if (hsv.s <= 0.0)
+	{
+		t->mode = TINT_GRAY;
+	}
+	else if (hsv.h >= 0)
+	{
+		double hh = hsv.h >= 360.0 ? 0.0 : hsv.h;
+		hh /= 60.0;
+		t->mode = TINT_HUE;
+		t->s = ToFixed(hsv.s);
+		t->sector = (int)hh;
+		t->f = ToFixed(hh - t->sector);
+	}
+	else
+	{
+		t->mode = TINT_SATURATION;
+		t->avgWeight = ToFixed(hsv.v * (1.0 - hsv.s));
+		t->componentWeight = ToFixed(hsv.v * hsv.s);
+	}
+}
+
+void TintFixedSetValue(TintFixed *t, HSV hsv)
+{
+	t->v = ToFixed(hsv.v);
+	if (t->mode == TINT_SATURATION)
+	{
+		t->avgWeight = ToFixed(hsv.v * (1.0 - hsv.s));
+		t->componentWeight = ToFixed(hsv.v * hsv.s);
+	}
+}
+
+// Same as ColorTint, step by step
+color_t ColorTintFixed(color_t c, const TintFixed *t)
+{
+	color_t out;
+	const int vAvg = ((int)c.r + c.g + c.b) / 3;
+	const int64_t vComponent = TintFixedToComponent(t->v * vAvg);
+	switch (t->mode)
+	{
+	case TINT_GRAY:
+		out.r = out.g = out.b = (uint8_t)vComponent;
+		break;
+	case TINT_HUE:
+		{
+			const uint8_t v = (uint8_t)vComponent;
+			const uint8_t p = (uint8_t)TintFixedToComponent(
+				vComponent * (TINT_FIXED_ONE - t->s));
+			const uint8_t q = (uint8_t)TintFixedToComponent(
+				vComponent * (TINT_FIXED_ONE -
+				((t->s * t->f) >> TINT_FIXED_SHIFT)));
+			const uint8_t tt = (uint8_t)TintFixedToComponent(
+				vComponent * (TINT_FIXED_ONE -
+				((t->s * (TINT_FIXED_ONE - t->f)) >> TINT_FIXED_SHIFT)));
+			switch (t->sector)
+			{
+			case 0:
+				out.r = v;
+				out.g = tt;
+				out.b = p;
+				break;
+			case 1:
+				out.r = q;
+				out.g = v;
+				out.b = p;
+				break;
+			case 2:
+				out.r = p;
+				out.g = v;
+				out.b = tt;
+				break;
+			case 3:
+				out.r = p;
+				out.g = q;
+				out.b = v;
+				break;
+			case 4:
+				out.r = tt;
+				out.g = p;
+				out.b = v;
+				break;
+			case 5:
+			default:
+				out.r = v;
+				out.g = p;
+				out.b = q;
+				break;
+			}
+		}
+		break;
+	case TINT_SATURATION:
+	default:
+		{
+			const int64_t avgTerm = t->avgWeight * vAvg;
+			out.r = (uint8_t)TintFixedToComponent(
+				avgTerm + t->componentWeight * c.r);
+			out.g = (uint8_t)TintFixedToComponent(
+				avgTerm + t->componentWeight * c.g);
+			out.b = (uint8_t)TintFixedToComponent(
+				avgTerm + t->componentWeight * c.b);
+		}
+		break;
+	}
+	out.a = c.a;
+	return out;
+}
+
+void TintLUTInit(TintLUT *t, HSV hsv)
+{
+	TintFixed f;
+	int i;
+	TintFixedInit(&f, hsv);
+	memset(t, 0, sizeof *t);
+	t->isBySum = f.mode != TINT_SATURATION;
+	for (i = 0; i < TINT_SUMS; i++)
+	{
+		if (t->isBySum)
+		{
+			// Any color with the same sum gives the same result
+			color_t c;
+			c.r = c.g = c.b = (uint8_t)(i / 3);
+			c.a = 255;
+			t->bySum[i] = PixelFromColor(ColorTintFixed(c, &f));
+		}
+		else
+		{
+			t->avgTerms[i] = f.avgWeight * (i / 3);
+		}
+	}
+	for (i = 0; i < 256; i++)
+	{
+		t->componentTerms[i] = f.componentWeight * i;
+	}
+}
+
 int ColorEquals(color_t a, color_t b)
 {
 	return a.r == b.r && a.g == b.g && a.b == b.b;
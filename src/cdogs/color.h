@@ -48,6 +48,33 @@ extern color_t colorBlack;
 extern color_t colorDarker;
 extern color_t colorPurple;
 extern color_t colorGray;
+extern color_t colorFog;
+
+// Internal framebuffer pixel format, fixed regardless of the screen format:
+// 32-bit ARGB8888, with the alpha byte left clear (as hqx expects)
+// Pixels are converted to the screen's format once per frame, in BlitFlip
+#define PIXEL_R_SHIFT 16
+#define PIXEL_G_SHIFT 8
+#define PIXEL_B_SHIFT 0
+#define PIXEL_R_MASK 0x00FF0000
+#define PIXEL_G_MASK 0x0000FF00
+#define PIXEL_B_MASK 0x000000FF
+static INLINE color_t PixelToColor(uint32_t pixel)
+{
+	color_t c;
+	c.r = (uint8_t)(pixel >> PIXEL_R_SHIFT);
+	c.g = (uint8_t)(pixel >> PIXEL_G_SHIFT);
+	c.b = (uint8_t)(pixel >> PIXEL_B_SHIFT);
+	c.a = 255;
+	return c;
+}
+static INLINE uint32_t PixelFromColor(color_t c)
+{
+	return
+		((uint32_t)c.r << PIXEL_R_SHIFT) |
+		((uint32_t)c.g << PIXEL_G_SHIFT) |
+		((uint32_t)c.b << PIXEL_B_SHIFT);
+}
 
 color_t ColorMult(color_t c, color_t m);
 color_t ColorAlphaBlend(color_t a, color_t b);
@@ -68,6 +95,75 @@ extern HSV tintDarker;
 // v: scale factor on the final components
 color_t ColorTint(color_t c, HSV hsv);
 
+// Tints compiled to integer math, for tinting many pixels
+// Results are within 1 of ColorTint per component
+typedef enum
+{
+	TINT_GRAY,
+	TINT_HUE,
+	TINT_SATURATION
+} TintMode;
+// Fixed point, with 16 fractional bits
+#define TINT_FIXED_SHIFT 16
+#define TINT_FIXED_ONE (1 << TINT_FIXED_SHIFT)
+typedef struct
+{
+	TintMode mode;
+	int64_t v;
+	// Hue tints: saturation, hue sector and position within the sector
+	int64_t s;
+	int64_t f;
+	int sector;
+	// Saturation tints: weights of the average and of the component
+	int64_t avgWeight;
+	int64_t componentWeight;
+} TintFixed;
+void TintFixedInit(TintFixed *t, HSV hsv);
+// Change a tint's value only; hsv must have the hue and saturation the tint
+// was made with
+void TintFixedSetValue(TintFixed *t, HSV hsv);
+color_t ColorTintFixed(color_t c, const TintFixed *t);
+
+// A tint's results for any pixel, from tables
+// Gray and hue tints only depend on the sum of the components, so their
+// results are tabled by sum. Saturation tints add a term of the average to
+// a term of each component, which are tabled separately.
+// Gives the same results as ColorTintFixed.
+#define TINT_SUMS (255 * 3 + 1)
+typedef struct
+{
+	int isBySum;
+	uint32_t bySum[TINT_SUMS];
+	int64_t avgTerms[TINT_SUMS];
+	int64_t componentTerms[256];
+} TintLUT;
+void TintLUTInit(TintLUT *t, HSV hsv);
+static INLINE int TintFixedToComponent(int64_t x)
+{
+	x >>= TINT_FIXED_SHIFT;
+	return x < 0 ? 0 : x > 255 ? 255 : (int)x;
+}
+static INLINE uint32_t TintLUTPixel(const TintLUT *t, uint32_t pixel)
+{
+	const int r = (pixel & PIXEL_R_MASK) >> PIXEL_R_SHIFT;
+	const int g = (pixel & PIXEL_G_MASK) >> PIXEL_G_SHIFT;
+	const int b = (pixel & PIXEL_B_MASK) >> PIXEL_B_SHIFT;
+	const int sum = r + g + b;
+	int64_t avgTerm;
+	if (t->isBySum)
+	{
+		return t->bySum[sum];
+	}
+	avgTerm = t->avgTerms[sum];
+	return
+		((uint32_t)TintFixedToComponent(avgTerm + t->componentTerms[r]) <<
+			PIXEL_R_SHIFT) |
+		((uint32_t)TintFixedToComponent(avgTerm + t->componentTerms[g]) <<
+			PIXEL_G_SHIFT) |
+		((uint32_t)TintFixedToComponent(avgTerm + t->componentTerms[b]) <<
+			PIXEL_B_SHIFT);
+}
+
 int ColorEquals(color_t a, color_t b);
 
 #endif
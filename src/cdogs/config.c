@@ -329,6 +329,9 @@ void ConfigLoadDefault(Config *config)
 	config->Graphics.ScaleFactor = 2;
 	config->Graphics.ShakeMultiplier = 1;
 	config->Graphics.ScaleMode = SCALE_MODE_HQX;
+	config->Graphics.CharacterCacheSize = 1024;
+	config->Graphics.ScaleBands = 0;
+	config->Graphics.PipelinedPresent = 1;
 	config->Input.PlayerKeys[0].Keys.left = SDLK_LEFT;
 	config->Input.PlayerKeys[0].Keys.right = SDLK_RIGHT;
 	config->Input.PlayerKeys[0].Keys.up = SDLK_UP;
@@ -29,6 +29,7 @@
 #include "config.h"
 
 #include "blit.h"
+#include "char_sprite_cache.h"
 #include "gamedata.h"
 #include "pic_manager.h"
 
@@ -37,6 +38,8 @@ int ConfigApply(Config *config)
 {
 	SoundReconfigure(&gSoundDevice, &config->Sound);
 	gCampaign.seed = config->Game.RandomSeed;
+	CharSpriteCacheSetBudget(
+		&gCharSpriteCache, config->Graphics.CharacterCacheSize * 1024);
 	GraphicsInitialize(
 		&gGraphicsDevice, &config->Graphics, gPicManager.palette, 0);
 	return gGraphicsDevice.IsInitialized;
@@ -109,6 +109,9 @@ static void LoadGraphicsConfigNode(GraphicsConfig *config, json_t *node)
 	LoadInt(&config->ScaleFactor, node, "ScaleFactor");
 	LoadInt(&config->ShakeMultiplier, node, "ShakeMultiplier");
 	JSON_UTILS_LOAD_ENUM(config->ScaleMode, node, "ScaleMode", StrScaleMode);
+	LoadInt(&config->CharacterCacheSize, node, "CharacterCacheSize");
+	LoadInt(&config->ScaleBands, node, "ScaleBands");
+	LoadBool(&config->PipelinedPresent, node, "PipelinedPresent");
 }
 static void AddGraphicsConfigNode(GraphicsConfig *config, json_t *root)
 {
@@ -121,6 +124,11 @@ static void AddGraphicsConfigNode(GraphicsConfig *config, json_t *root)
 	AddIntPair(subConfig, "ScaleFactor", config->ScaleFactor);
 	AddIntPair(subConfig, "ShakeMultiplier", config->ShakeMultiplier);
 	JSON_UTILS_ADD_ENUM_PAIR(subConfig, "ScaleMode", config->ScaleMode, ScaleModeStr);
+	AddIntPair(subConfig, "CharacterCacheSize", config->CharacterCacheSize);
+	AddIntPair(subConfig, "ScaleBands", config->ScaleBands);
+	json_insert_pair_into_object(
+		subConfig, "PipelinedPresent",
+		json_new_bool(config->PipelinedPresent));
 	json_insert_pair_into_object(root, "Graphics", subConfig);
 }
 
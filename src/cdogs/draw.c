@@ -47,379 +47,608 @@
     POSSIBILITY OF SUCH DAMAGE.
 */
 #include <assert.h>
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include "actors.h"
+#include "char_sprite_cache.h"
 #include "config.h"
 #include "pics.h"
 #include "draw.h"
+#include "floor_layer.h"
 #include "blit.h"
 #include "pic_manager.h"
 #include "text.h"
+#include "tile_cache.h"
 
 
-void FixBuffer(DrawBuffer *buffer)
+// Integer division rounding down, for negative positions too
+static INLINE int DivFloor(int a, int b)
+{
+	return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+// Flag the floors of the cells entirely inside the rectangle at pos, which
+// is relative to the first cell
+static void HideFloors(DrawBuffer *buffer, Vec2i pos, Vec2i size)
+{
+	const int xFirst = MAX(0, -DivFloor(-pos.x, TILE_WIDTH));
+	const int yFirst = MAX(0, -DivFloor(-pos.y, TILE_HEIGHT));
+	const int xLast =
+		MIN(buffer->width, DivFloor(pos.x + size.x, TILE_WIDTH)) - 1;
+	const int yLast =
+		MIN(buffer->height, DivFloor(pos.y + size.y, TILE_HEIGHT)) - 1;
+	int x, y;
+	for (y = yFirst; y <= yLast; y++)
+	{
+		for (x = xFirst; x <= xLast; x++)
+		{
+			*DrawBufferGetFlags(buffer, x, y) |= DRAW_TILE_FLOOR_HIDDEN;
+		}
+	}
+}
+
+void FixBuffer(DrawBuffer *buffer, const FOVBits *visible)
 {
 	int x, y;
-	Tile *tile, *tileBelow;
 
-	tile = &buffer->tiles[0][0];
-	tileBelow = &buffer->tiles[0][0] + X_TILES;
-	for (y = 0; y < Y_TILES - 1; y++)
+	for (y = 0; y < buffer->height - 1; y++)
 	{
-		for (x = 0; x < buffer->width; x++, tile++, tileBelow++)
+		for (x = 0; x < buffer->width; x++)
 		{
+			const Tile *tile = DrawBufferGetTile(buffer, x, y);
+			const Tile *tileBelow = DrawBufferGetTile(buffer, x, y + 1);
 			if (!(tile->flags & (MAPTILE_IS_WALL | MAPTILE_OFFSET_PIC)) &&
 				(tileBelow->flags & MAPTILE_IS_WALL))
 			{
-				tile->pic = &picNone;
+				*DrawBufferGetFlags(buffer, x, y) |= DRAW_TILE_NO_FLOOR;
 			}
 			else if ((tile->flags & MAPTILE_IS_WALL) &&
 				(tileBelow->flags & MAPTILE_IS_WALL))
 			{
-				tile->flags |= MAPTILE_DELAY_DRAW;
+				*DrawBufferGetFlags(buffer, x, y) |= DRAW_TILE_DELAY_DRAW;
+			}
+		}
+	}
+
+	// Occlusion culling: walls and doors are opaque, blacked out or copied
+	// from the tile cache, and drawn after the floor, so the floor under
+	// them would be overdrawn
+	for (y = 0; y < buffer->height; y++)
+	{
+		for (x = 0; x < buffer->width; x++)
+		{
+			Tile *tile = DrawBufferGetTile(buffer, x, y);
+			Pic *pic;
+			if (tile->flags & MAPTILE_IS_WALL)
+			{
+				pic = tile->pic;
+			}
+			else if (tile->flags & MAPTILE_OFFSET_PIC)
+			{
+				pic = &tile->picAlt;
+			}
+			else
+			{
+				continue;
+			}
+			if (pic == NULL || !PicIsNotNone(pic))
+			{
+				continue;
 			}
+			HideFloors(
+				buffer,
+				Vec2iNew(
+					x * TILE_WIDTH + cWallOffset.dx + pic->offset.x,
+					y * TILE_HEIGHT + cWallOffset.dy + pic->offset.y),
+				pic->size);
 		}
-		tile += X_TILES - buffer->width;
-		tileBelow += X_TILES - buffer->width;
 	}
 
-	tile = &buffer->tiles[0][0];
-	for (y = 0; y < Y_TILES; y++)
+	for (y = 0; y < buffer->height; y++)
 	{
-		for (x = 0; x < buffer->width; x++, tile++)
+		for (x = 0; x < buffer->width; x++)
 		{
-			if (!(tile->flags & MAPTILE_IS_VISIBLE))
+			const Vec2i mapTile =
+				Vec2iNew(x + buffer->xStart, y + buffer->yStart);
+			if (mapTile.x < 0 || mapTile.x >= XMAX ||
+				mapTile.y < 0 || mapTile.y >= YMAX ||
+				!FOVBitsGet(visible, mapTile))
 			{
-				tile->things = NULL;
-				tile->flags |= MAPTILE_OUT_OF_SIGHT;
+				*DrawBufferGetFlags(buffer, x, y) |= DRAW_TILE_OUT_OF_SIGHT;
 			}
 			else
 			{
-				MapMarkAsVisited(
-					Vec2iNew(x + buffer->xStart, y + buffer->yStart));
-				tile->flags &= ~MAPTILE_OUT_OF_SIGHT;
-				tile->isVisited = 1;
+				const TileItemCell *cell = DrawBufferGetItems(buffer, x, y);
+				int i;
+				MapMarkAsVisited(mapTile);
+				// Characters are seen here rather than when drawn, since
+				// viewports may be drawn concurrently
+				for (i = 0; i < cell->count; i++)
+				{
+					if (cell->entries[i].kind == KIND_CHARACTER)
+					{
+						ActorSetSeen(cell->entries[i].item->data);
+					}
+				}
 			}
 		}
-		tile += X_TILES - buffer->width;
 	}
 }
 
-static void SetVisible(DrawBuffer *buffer, int x, int y)
+
+// The blits of a viewport are either drawn straight away, or recorded with
+// the pixels they touch, measured by running them on a measuring device
+void DrawCommandRun(const DrawCommand *cmd, GraphicsDevice *device)
 {
-	Tile *tile = &buffer->tiles[0][0] + y*X_TILES + x;
-	tile->flags |= MAPTILE_IS_VISIBLE;
+	switch (cmd->type)
+	{
+	case DRAW_COMMAND_FLOOR:
+		FloorLayerDraw(
+			&gFloorLayer, device, cmd->u.floor.start, cmd->u.floor.count,
+			cmd->pos);
+		break;
+	case DRAW_COMMAND_FILL:
+		BlitFill(device, cmd->u.fill.size, cmd->pos, cmd->u.fill.pixel);
+		break;
+	case DRAW_COMMAND_TILE:
+		TileCacheDraw(
+			&gTileCache, device, cmd->u.tile.pic, cmd->pos,
+			cmd->u.tile.isFogged);
+		break;
+	case DRAW_COMMAND_ITEM:
+		(*(cmd->u.item->drawFunc))(
+			device, cmd->pos.x, cmd->pos.y, cmd->u.item->data);
+		break;
+	default:
+		assert(0 && "invalid draw command");
+		break;
+	}
 }
-
-// Set current tile to visible if the last tile is visible and
-// is not an obstruction
-static void SetLineOfSight(
-	DrawBuffer *buffer, int x, int y, int dx, int dy)
+static void DrawCommandEmit(DrawContext *c, DrawCommand *cmd)
 {
-	Tile *dTile = &buffer->tiles[0][0] + (y+dy)*X_TILES + (x+dx);
-	if ((dTile->flags & MAPTILE_IS_VISIBLE) &&
-		!(dTile->flags & MAPTILE_NO_SEE))
+	DrawCommandList *l = &c->commandList;
+	if (!l->isRecording)
+	{
+		DrawCommandRun(cmd, &c->device);
+		return;
+	}
+	cmd->bounds.left = cmd->bounds.top = INT_MAX;
+	cmd->bounds.right = cmd->bounds.bottom = INT_MIN;
+	c->device.measure = &cmd->bounds;
+	DrawCommandRun(cmd, &c->device);
+	c->device.measure = NULL;
+	if (cmd->bounds.left > cmd->bounds.right)
 	{
-		SetVisible(buffer, x, y);
+		// Draws nothing
+		return;
+	}
+	if (l->count == l->size)
+	{
+		l->size = MAX(256, l->size * 2);
+		CREALLOC(l->commands, l->size * sizeof *l->commands);
 	}
+	l->commands[l->count++] = *cmd;
+}
+static void DrawFill(DrawContext *c, Vec2i size, Vec2i pos)
+{
+	DrawCommand cmd;
+	cmd.type = DRAW_COMMAND_FILL;
+	cmd.pos = pos;
+	cmd.u.fill.size = size;
+	cmd.u.fill.pixel = PixelFromColor(colorBlack);
+	DrawCommandEmit(c, &cmd);
+}
+static void DrawCachedTile(DrawContext *c, Pic *pic, Vec2i pos, int isFogged)
+{
+	DrawCommand cmd;
+	cmd.type = DRAW_COMMAND_TILE;
+	cmd.pos = pos;
+	cmd.u.tile.pic = pic;
+	cmd.u.tile.isFogged = isFogged;
+	DrawCommandEmit(c, &cmd);
 }
 
-// Calculate line of sight using raycasting
-// Start from tiles that are sources of light (i.e. visible)
-// Then going outwards, mark tiles as visible unless obstructions
-// e.g. walls are encountered, and leave the rest unlit
-void LineOfSight(Vec2i center, DrawBuffer *buffer)
+// Three types of tile drawing, based on line of sight:
+// Unvisited: black
+// Out of sight: dark, or if fog disabled, black
+// In sight: full color
+// Visible and fogged walls and doors are copied from the tile cache; black
+// ones are still filled in as they can cover things behind them.
+// Floors are drawn separately, see DrawFloor.
+static void DrawTile(
+	DrawContext *c, int isVisited, int flags, Pic *pic, Vec2i pos)
 {
-	int x, y;
-	Vec2i centerTile;
-	int sightRange2 = 0;
-	
-	if (gConfig.Game.SightRange > 0)
-	{
-		sightRange2 = gConfig.Game.SightRange * gConfig.Game.SightRange;
-	}
-
-	centerTile.x = center.x / TILE_WIDTH - buffer->xStart;
-	centerTile.y = center.y / TILE_HEIGHT - buffer->yStart;
-	
-	// First mark center tile and all adjacent tiles as visible
-	// +-+-+-+
-	// |V|V|V|
-	// +-+-+-+
-	// |V|C|V|
-	// +-+-+-+
-	// |V|V|V|  (C=center, V=visible)
-	// +-+-+-+
-	for (x = centerTile.x - 1; x < centerTile.x + 2; x++)
-	{
-		for (y = centerTile.y - 1; y < centerTile.y + 2; y++)
-		{
-			SetVisible(buffer, x, y);
-		}
+	const int isOutOfSight = flags & DRAW_TILE_OUT_OF_SIGHT;
+	if (!isVisited || (isOutOfSight && !gConfig.Game.Fog))
+	{
+		DrawFill(c, pic->size, Vec2iAdd(pos, pic->offset));
+		return;
 	}
+	DrawCachedTile(c, pic, pos, isOutOfSight);
+}
 
-	// Going outwards, mark tiles as visible if the inner tile
-	// is visible and is not an obstruction
-	y = centerTile.y;
-	for (x = centerTile.x - 2; x >= 0; x--)
+static void DrawWallColumn(DrawContext *c, int x, int y, Vec2i pos)
+{
+	DrawBuffer *b = &c->buffer;
+	Tile *tile;
+	while (y >= 0 &&
+		((tile = DrawBufferGetTile(b, x, y))->flags & MAPTILE_IS_WALL))
 	{
-		if (sightRange2 > 0 &&
-			DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
-		{
-			break;
-		}
-		SetLineOfSight(buffer, x, y, 1, 0);
+		DrawTile(
+			c, DrawBufferIsVisited(b, x, y), *DrawBufferGetFlags(b, x, y),
+			tile->pic, pos);
+		pos.y -= TILE_HEIGHT;
+		y--;
 	}
-	for (x = centerTile.x + 2; x < buffer->width; x++)
+}
+
+
+void DrawContextInit(DrawContext *c, Vec2i tiles)
+{
+	memset(c, 0, sizeof *c);
+	DrawBufferInit(&c->buffer, tiles);
+}
+void DrawContextTerminate(DrawContext *c)
+{
+	DrawBufferTerminate(&c->buffer);
+	CFREE(c->displayList.items);
+	CFREE(c->displayList.sorted);
+	CFREE(c->displayList.counts);
+	CFREE(c->commandList.commands);
+	CFREE(c->commandList.binStarts);
+	CFREE(c->commandList.binCommands);
+}
+void DrawContextSetDevice(
+	DrawContext *c, const GraphicsDevice *device,
+	int left, int top, int right, int bottom)
+{
+	c->device = *device;
+	GraphicsSetBlitClip(&c->device, left, top, right, bottom);
+}
+
+
+void DrawFloor(DrawContext *c, Vec2i offset);
+void DrawDebris(DrawContext *c, Vec2i offset);
+void DrawWallsAndThings(DrawContext *c, Vec2i offset);
+
+void DrawBufferDraw(DrawContext *c, Vec2i offset)
+{
+	// First draw the floor tiles (which do not obstruct anything)
+	DrawFloor(c, offset);
+	// Then draw debris (wrecks)
+	DrawDebris(c, offset);
+	// Now draw walls and (non-wreck) things in proper order
+	DrawWallsAndThings(c, offset);
+}
+
+// The bins touched by bounds, which are inside clip
+static void GetBinRange(
+	const BlitClipping *clip, const BlitClipping *bounds, BlitClipping *r)
+{
+	r->left = (bounds->left - clip->left) / DRAW_BIN_WIDTH;
+	r->top = (bounds->top - clip->top) / DRAW_BIN_HEIGHT;
+	r->right = (bounds->right - clip->left) / DRAW_BIN_WIDTH;
+	r->bottom = (bounds->bottom - clip->top) / DRAW_BIN_HEIGHT;
+}
+
+// Bin the commands by counting sort, so that the commands of each bin stay
+// in painter's order
+static void DrawCommandListBin(DrawCommandList *l, const BlitClipping *clip)
+{
+	int binCount;
+	int total;
+	int i;
+	l->bins.x =
+		MAX(0, (clip->right - clip->left + DRAW_BIN_WIDTH) / DRAW_BIN_WIDTH);
+	l->bins.y =
+		MAX(0, (clip->bottom - clip->top + DRAW_BIN_HEIGHT) / DRAW_BIN_HEIGHT);
+	binCount = l->bins.x * l->bins.y;
+	if (binCount + 1 > l->binStartsSize)
 	{
-		if (sightRange2 > 0 &&
-			DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
-		{
-			break;
-		}
-		SetLineOfSight(buffer, x, y, -1, 0);
+		l->binStartsSize = binCount + 1;
+		CREALLOC(l->binStarts, l->binStartsSize * sizeof *l->binStarts);
 	}
-	for (y = centerTile.y - 1; y >= 0; y--)
+	memset(l->binStarts, 0, (binCount + 1) * sizeof *l->binStarts);
+	for (i = 0; i < l->count; i++)
 	{
-		x = centerTile.x;
-		if (sightRange2 > 0 &&
-			DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
-		{
-			break;
-		}
-		SetLineOfSight(buffer, x, y, 0, 1);
-		for (x = centerTile.x - 1; x >= 0; x--)
+		BlitClipping r;
+		int x, y;
+		GetBinRange(clip, &l->commands[i].bounds, &r);
+		for (y = r.top; y <= r.bottom; y++)
 		{
-			if (sightRange2 > 0 &&
-				DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
+			for (x = r.left; x <= r.right; x++)
 			{
-				break;
+				l->binStarts[y * l->bins.x + x]++;
 			}
-			SetLineOfSight(buffer, x, y, 1, 1);
-		}
-		for (x = centerTile.x + 1; x < buffer->width; x++)
-		{
-			if (sightRange2 > 0 &&
-				DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
-			{
-				break;
-			}
-			SetLineOfSight(buffer, x, y, -1, 1);
 		}
 	}
-	for (y = centerTile.y + 1; y < Y_TILES; y++)
+	// Turn counts into start positions
+	for (i = 0, total = 0; i < binCount; i++)
 	{
-		x = centerTile.x;
-		if (sightRange2 > 0 &&
-			DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
-		{
-			break;
-		}
-		SetLineOfSight(buffer, x, y, 0, -1);
-		for (x = centerTile.x - 1; x >= 0; x--)
-		{
-			if (sightRange2 > 0 &&
-				DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
-			{
-				break;
-			}
-			SetLineOfSight(buffer, x, y, 1, -1);
-		}
-		for (x = centerTile.x + 1; x < buffer->width; x++)
+		const int count = l->binStarts[i];
+		l->binStarts[i] = total;
+		total += count;
+	}
+	l->binStarts[binCount] = total;
+	if (total > l->binCommandsSize)
+	{
+		l->binCommandsSize = MAX(total, l->binCommandsSize * 2);
+		CREALLOC(l->binCommands, l->binCommandsSize * sizeof *l->binCommands);
+	}
+	for (i = 0; i < l->count; i++)
+	{
+		BlitClipping r;
+		int x, y;
+		GetBinRange(clip, &l->commands[i].bounds, &r);
+		for (y = r.top; y <= r.bottom; y++)
 		{
-			if (sightRange2 > 0 &&
-				DistanceSquared(centerTile, Vec2iNew(x, y)) >= sightRange2)
+			for (x = r.left; x <= r.right; x++)
 			{
-				break;
+				l->binCommands[l->binStarts[y * l->bins.x + x]++] = i;
 			}
-			SetLineOfSight(buffer, x, y, -1, -1);
 		}
 	}
+	// Each start has moved on to the next bin's start; shift them back
+	memmove(l->binStarts + 1, l->binStarts, binCount * sizeof *l->binStarts);
+	l->binStarts[0] = 0;
 }
 
+void DrawBufferRecord(DrawContext *c, Vec2i offset)
+{
+	DrawCommandList *l = &c->commandList;
+	l->count = 0;
+	l->isRecording = 1;
+	DrawBufferDraw(c, offset);
+	l->isRecording = 0;
+	DrawCommandListBin(l, &c->device.clipping);
+}
 
-// Three types of tile drawing, based on line of sight:
-// Unvisited: black
-// Out of sight: dark, or if fog disabled, black
-// In sight: full color
-static color_t GetTileLOSMask(Tile *tile)
+int DrawContextGetBinCount(const DrawContext *c)
+{
+	return c->commandList.bins.x * c->commandList.bins.y;
+}
+
+void DrawContextDrawBin(DrawContext *c, int bin)
 {
-	if (!tile->isVisited)
+	const DrawCommandList *l = &c->commandList;
+	const BlitClipping *clip = &c->device.clipping;
+	// Draw through a copy of the device clipped to the bin's screen tile
+	GraphicsDevice device = c->device;
+	int i;
+	device.clipping.left = clip->left + (bin % l->bins.x) * DRAW_BIN_WIDTH;
+	device.clipping.top = clip->top + (bin / l->bins.x) * DRAW_BIN_HEIGHT;
+	device.clipping.right =
+		MIN(clip->right, device.clipping.left + DRAW_BIN_WIDTH - 1);
+	device.clipping.bottom =
+		MIN(clip->bottom, device.clipping.top + DRAW_BIN_HEIGHT - 1);
+	for (i = l->binStarts[bin]; i < l->binStarts[bin + 1]; i++)
 	{
-		return colorBlack;
+		DrawCommandRun(&l->commands[l->binCommands[i]], &device);
 	}
-	if (tile->flags & MAPTILE_OUT_OF_SIGHT)
+}
+
+// Copy the runs of cells in a row whose floor isn't hidden from the floor
+// layer
+static void DrawFloorRow(DrawContext *c, int y, Vec2i pos)
+{
+	DrawBuffer *b = &c->buffer;
+	int x = 0;
+	while (x < b->width)
 	{
-		if (gConfig.Game.Fog)
+		DrawCommand cmd;
+		const int xFirst = x;
+		if (*DrawBufferGetFlags(b, x, y) & DRAW_TILE_FLOOR_HIDDEN)
 		{
-			color_t mask = { 96, 96, 96, 255 };
-			return mask;
+			x++;
+			continue;
 		}
-		else
+		while (x < b->width &&
+			!(*DrawBufferGetFlags(b, x, y) & DRAW_TILE_FLOOR_HIDDEN))
 		{
-			return colorBlack;
+			x++;
 		}
+		cmd.type = DRAW_COMMAND_FLOOR;
+		cmd.pos = Vec2iNew(pos.x + xFirst * TILE_WIDTH, pos.y);
+		cmd.u.floor.start = Vec2iNew(b->xStart + xFirst, b->yStart + y);
+		cmd.u.floor.count = Vec2iNew(x - xFirst, 1);
+		DrawCommandEmit(c, &cmd);
 	}
-	return colorWhite;
 }
 
-void DrawWallColumn(int y, Vec2i pos, Tile *tile)
-{
-	while (y >= 0 && (tile->flags & MAPTILE_IS_WALL))
-	{
-		BlitMasked(
-			&gGraphicsDevice,
-			tile->pic,
-			pos,
-			GetTileLOSMask(tile),
-			0);
-		pos.y -= TILE_HEIGHT;
-		tile -= X_TILES;
-		y--;
-	}
-}
-
-
-void DrawFloor(DrawBuffer *b, Vec2i offset);
-void DrawDebris(DrawBuffer *b, Vec2i offset);
-void DrawWallsAndThings(DrawBuffer *b, Vec2i offset);
-
-void DrawBufferDraw(DrawBuffer *b, Vec2i offset)
-{
-	// First draw the floor tiles (which do not obstruct anything)
-	DrawFloor(b, offset);
-	// Then draw debris (wrecks)
-	DrawDebris(b, offset);
-	// Now draw walls and (non-wreck) things in proper order
-	DrawWallsAndThings(b, offset);
-}
-
-void DrawFloor(DrawBuffer *b, Vec2i offset)
+// The floor is copied from the pre-rendered floor layer, then tiles that
+// aren't fully visible are fogged or blacked out over it
+// Floors hidden under walls and doors are skipped
+void DrawFloor(DrawContext *c, Vec2i offset)
 {
+	DrawBuffer *b = &c->buffer;
 	int x, y;
 	Vec2i pos;
-	Tile *tile = &b->tiles[0][0];
 	for (y = 0, pos.y = b->dy + offset.y;
-		 y < Y_TILES;
+		 y < b->height;
+		 y++, pos.y += TILE_HEIGHT)
+	{
+		DrawFloorRow(c, y, Vec2iNew(b->dx + offset.x, pos.y));
+	}
+	for (y = 0, pos.y = b->dy + offset.y;
+		 y < b->height;
 		 y++, pos.y += TILE_HEIGHT)
 	{
 		for (x = 0, pos.x = b->dx + offset.x;
 			 x < b->width;
-			 x++, tile++, pos.x += TILE_WIDTH)
+			 x++, pos.x += TILE_WIDTH)
 		{
-			if (tile->pic != NULL && PicIsNotNone(tile->pic) &&
-				!(tile->flags & (MAPTILE_IS_WALL | MAPTILE_OFFSET_PIC)))
+			Tile *tile = DrawBufferGetTile(b, x, y);
+			const int flags = *DrawBufferGetFlags(b, x, y);
+			// Tiles outside the map aren't in the layer
+			if (tile->pic == NULL ||
+				(tile->flags & (MAPTILE_IS_WALL | MAPTILE_OFFSET_PIC)) ||
+				(flags & DRAW_TILE_FLOOR_HIDDEN))
 			{
-				BlitMasked(
-					&gGraphicsDevice,
-					tile->pic,
-					pos,
-					GetTileLOSMask(tile),
-					0);
+				continue;
+			}
+			if ((flags & DRAW_TILE_NO_FLOOR) ||
+				!PicIsNotNone(tile->pic) ||
+				!DrawBufferIsVisited(b, x, y) ||
+				((flags & DRAW_TILE_OUT_OF_SIGHT) && !gConfig.Game.Fog))
+			{
+				// Covered up by a wall, or can't be seen
+				DrawFill(c, Vec2iNew(TILE_WIDTH, TILE_HEIGHT), pos);
+			}
+			else if (flags & DRAW_TILE_OUT_OF_SIGHT)
+			{
+				DrawCachedTile(c, tile->pic, pos, 1);
 			}
 		}
-		tile += X_TILES - b->width;
 	}
 }
 
-void AddItemToDisplayList(TTileItem * t, TTileItem **list);
+static void DisplayListAdd(DisplayList *dl, TTileItem *t)
+{
+	if (dl->count == dl->size)
+	{
+		dl->size = MAX(64, dl->size * 2);
+		CREALLOC(dl->items, dl->size * sizeof *dl->items);
+		CREALLOC(dl->sorted, dl->size * sizeof *dl->sorted);
+	}
+	dl->items[dl->count++] = t;
+}
+
+// Counting sort by y into sorted; the y values of a row's items fall in a
+// small range, about a tile's height
+// Items with equal y are ordered newest first, as before with the old
+// insertion sort
+static void DisplayListSort(DisplayList *dl)
+{
+	int minY, maxY;
+	int range;
+	int i;
+	int start;
+	if (dl->count == 0)
+	{
+		return;
+	}
+	minY = maxY = dl->items[0]->y;
+	for (i = 1; i < dl->count; i++)
+	{
+		minY = MIN(minY, dl->items[i]->y);
+		maxY = MAX(maxY, dl->items[i]->y);
+	}
+	range = maxY - minY + 1;
+	if (range > dl->countsSize)
+	{
+		dl->countsSize = MAX(range, TILE_HEIGHT * 2);
+		CREALLOC(dl->counts, dl->countsSize * sizeof *dl->counts);
+	}
+	memset(dl->counts, 0, range * sizeof *dl->counts);
+	for (i = 0; i < dl->count; i++)
+	{
+		dl->counts[dl->items[i]->y - minY]++;
+	}
+	// Turn counts into start positions
+	for (i = 0, start = 0; i < range; i++)
+	{
+		const int count = dl->counts[i];
+		dl->counts[i] = start;
+		start += count;
+	}
+	for (i = dl->count - 1; i >= 0; i--)
+	{
+		dl->sorted[dl->counts[dl->items[i]->y - minY]++] = dl->items[i];
+	}
+}
+
+static void DisplayListDraw(DrawContext *c, Vec2i offset)
+{
+	DisplayList *dl = &c->displayList;
+	const DrawBuffer *b = &c->buffer;
+	int i;
+	DisplayListSort(dl);
+	for (i = 0; i < dl->count; i++)
+	{
+		const TTileItem *t = dl->sorted[i];
+		DrawCommand cmd;
+		cmd.type = DRAW_COMMAND_ITEM;
+		cmd.pos = Vec2iNew(
+			t->x - b->xTop + offset.x, t->y - b->yTop + offset.y);
+		cmd.u.item = t;
+		DrawCommandEmit(c, &cmd);
+	}
+	dl->count = 0;
+}
 
-void DrawDebris(DrawBuffer *b, Vec2i offset)
+void DrawDebris(DrawContext *c, Vec2i offset)
 {
+	DrawBuffer *b = &c->buffer;
 	int x, y;
-	Tile *tile = &b->tiles[0][0];
-	for (y = 0; y < Y_TILES; y++)
+	for (y = 0; y < b->height; y++)
 	{
-		TTileItem *displayList = NULL;
-		TTileItem *t;
-		for (x = 0; x < b->width; x++, tile++)
+		for (x = 0; x < b->width; x++)
 		{
-			for (t = tile->things; t; t = t->next)
+			const TileItemCell *cell;
+			int i;
+			// Things out of sight aren't drawn
+			if (*DrawBufferGetFlags(b, x, y) & DRAW_TILE_OUT_OF_SIGHT)
 			{
-				if (t->flags & TILEITEM_IS_WRECK)
+				continue;
+			}
+			cell = DrawBufferGetItems(b, x, y);
+			for (i = cell->count - 1; i >= 0; i--)
+			{
+				if (cell->entries[i].flags & TILEITEM_IS_WRECK)
 				{
-					AddItemToDisplayList(t, &displayList);
+					DisplayListAdd(&c->displayList, cell->entries[i].item);
 				}
 			}
 		}
-		for (t = displayList; t; t = t->nextToDisplay)
-		{
-			(*(t->drawFunc))(
-				t->x - b->xTop + offset.x, t->y - b->yTop + offset.y, t->data);
-		}
-		tile += X_TILES - b->width;
+		DisplayListDraw(c, offset);
 	}
 }
 
-void DrawWallsAndThings(DrawBuffer *b, Vec2i offset)
+void DrawWallsAndThings(DrawContext *c, Vec2i offset)
 {
+	DrawBuffer *b = &c->buffer;
 	int x, y;
 	Vec2i pos;
-	Tile *tile = &b->tiles[0][0];
 	pos.y = b->dy + cWallOffset.dy + offset.y;
-	for (y = 0; y < Y_TILES; y++, pos.y += TILE_HEIGHT)
+	for (y = 0; y < b->height; y++, pos.y += TILE_HEIGHT)
 	{
-		TTileItem *displayList = NULL;
-		TTileItem *t;
 		pos.x = b->dx + cWallOffset.dx + offset.x;
-		for (x = 0; x < b->width; x++, tile++, pos.x += TILE_WIDTH)
+		for (x = 0; x < b->width; x++, pos.x += TILE_WIDTH)
 		{
+			Tile *tile = DrawBufferGetTile(b, x, y);
+			const int flags = *DrawBufferGetFlags(b, x, y);
+			const TileItemCell *cell;
+			int i;
 			if (tile->flags & MAPTILE_IS_WALL)
 			{
-				if (!(tile->flags & MAPTILE_DELAY_DRAW))
+				if (!(flags & DRAW_TILE_DELAY_DRAW))
 				{
-					DrawWallColumn(y, pos, tile);
+					DrawWallColumn(c, x, y, pos);
 				}
 			}
 			else if (tile->flags & MAPTILE_OFFSET_PIC)
 			{
 				// Drawing doors
-				BlitMasked(
-					&gGraphicsDevice,
-					&tile->picAlt,
-					pos,
-					GetTileLOSMask(tile),
-					0);
+				DrawTile(
+					c, DrawBufferIsVisited(b, x, y), flags, &tile->picAlt, pos);
+			}
+			// Things out of sight aren't drawn
+			if (flags & DRAW_TILE_OUT_OF_SIGHT)
+			{
+				continue;
 			}
-			for (t = tile->things; t; t = t->next)
+			cell = DrawBufferGetItems(b, x, y);
+			for (i = cell->count - 1; i >= 0; i--)
 			{
-				if (!(t->flags & TILEITEM_IS_WRECK))
+				if (!(cell->entries[i].flags & TILEITEM_IS_WRECK))
 				{
-					AddItemToDisplayList(t, &displayList);
+					DisplayListAdd(&c->displayList, cell->entries[i].item);
 				}
 			}
 		}
-		for (t = displayList; t; t = t->nextToDisplay)
-		{
-			(*(t->drawFunc))(
-				t->x - b->xTop + offset.x, t->y - b->yTop + offset.y, t->data);
-		}
-		tile += X_TILES - b->width;
-	}
-}
-
-void AddItemToDisplayList(TTileItem * t, TTileItem **list)
-{
-	TTileItem *l;
-	TTileItem *lPrev;
-	t->nextToDisplay = NULL;
-	for (lPrev = NULL, l = *list; l; lPrev = l, l = l->nextToDisplay)
-	{
-		// draw in Y order
-		if (l->y >= t->y)
-		{
-			break;
-		}
-	}
-	t->nextToDisplay = l;
-	if (lPrev)
-	{
-		lPrev->nextToDisplay = t;
-	}
-	else
-	{
-		*list = t;
+		DisplayListDraw(c, offset);
 	}
 }
 
@@ -429,7 +658,7 @@ void DrawCharacterSimple(
 	int gunPic, gunstate_e gunState, TranslationTable *table)
 {
 	TOffsetPic body, head, gun;
-	TOffsetPic pic1, pic2, pic3;
+	CharSpriteKey key;
 	direction_e headDir = dir;
 	int headState = state;
 	int bodyType = c->looks.armedBody;
@@ -479,52 +708,33 @@ void DrawCharacterSimple(
 	{
 	case DIRECTION_UP:
 	case DIRECTION_UPRIGHT:
-		pic1 = gun;
-		pic2 = head;
-		pic3 = body;
+		key.layers[0] = gun;
+		key.layers[1] = head;
+		key.layers[2] = body;
 		break;
 
 	case DIRECTION_RIGHT:
 	case DIRECTION_DOWNRIGHT:
 	case DIRECTION_DOWN:
 	case DIRECTION_DOWNLEFT:
-		pic1 = body;
-		pic2 = head;
-		pic3 = gun;
+		key.layers[0] = body;
+		key.layers[1] = head;
+		key.layers[2] = gun;
 		break;
 
 	case DIRECTION_LEFT:
 	case DIRECTION_UPLEFT:
-		pic1 = gun;
-		pic2 = body;
-		pic3 = head;
+		key.layers[0] = gun;
+		key.layers[1] = body;
+		key.layers[2] = head;
 		break;
 	default:
 		assert(0 && "invalid direction");
 		return;
 	}
 
-	if (pic1.picIndex >= 0)
-	{
-		Blit(
-			pos.x + pic1.dx, pos.y + pic1.dy,
-			PicManagerGetOldPic(&gPicManager, pic1.picIndex),
-			table, BLIT_TRANSPARENT);
-	}
-	if (pic2.picIndex >= 0)
-	{
-		Blit(
-			pos.x + pic2.dx, pos.y + pic2.dy,
-			PicManagerGetOldPic(&gPicManager, pic2.picIndex),
-			table, BLIT_TRANSPARENT);
-	}
-	if (pic3.picIndex >= 0)
-	{
-		Blit(
-			pos.x + pic3.dx, pos.y + pic3.dy,
-			PicManagerGetOldPic(&gPicManager, pic3.picIndex),
-			table, BLIT_TRANSPARENT);
-	}
+	key.table = table;
+	CharSpriteCacheDraw(&gCharSpriteCache, &gGraphicsDevice, &key, pos);
 }
 
 void DisplayPlayer(int x, const char *name, Character *c, int editingName)
@@ -50,11 +50,109 @@
 #define __DRAW
 
 #include "draw_buffer.h"
+#include "fov.h"
 #include "gamedata.h"
 
-void LineOfSight(Vec2i center, DrawBuffer *buffer);
-void FixBuffer(DrawBuffer *b);
-void DrawBufferDraw(DrawBuffer *b, Vec2i offset);
+// Tile items of a row, to be drawn in y order
+// The arrays are reused between rows and frames
+typedef struct
+{
+	TTileItem **items;
+	TTileItem **sorted;
+	int count;
+	int size;
+	int *counts;
+	int countsSize;
+} DisplayList;
+
+// A blit recorded by DrawBufferRecord, to be drawn later, screen tile by
+// screen tile
+typedef enum
+{
+	DRAW_COMMAND_FLOOR,	// tiles of the floor layer
+	DRAW_COMMAND_FILL,
+	DRAW_COMMAND_TILE,	// wall or door from the tile cache
+	DRAW_COMMAND_ITEM	// tile item, with its draw function
+} DrawCommandType;
+typedef struct
+{
+	DrawCommandType type;
+	Vec2i pos;
+	union
+	{
+		struct
+		{
+			Vec2i start;
+			Vec2i count;
+		} floor;
+		struct
+		{
+			Vec2i size;
+			Uint32 pixel;
+		} fill;
+		struct
+		{
+			Pic *pic;
+			int isFogged;
+		} tile;
+		const TTileItem *item;
+	} u;
+	// The pixels the command draws, as measured when recorded
+	BlitClipping bounds;
+} DrawCommand;
+
+// Commands in painter's order, and binned by the screen tiles they touch
+// The screen tiles cover the clipping rectangle, in rows; each bin lists
+// the indices of its commands, in order, from binStarts[bin] to
+// binStarts[bin + 1]. Arrays are reused between frames.
+typedef struct
+{
+	DrawCommand *commands;
+	int count;
+	int size;
+	int isRecording;
+	Vec2i bins;
+	int *binStarts;
+	int binStartsSize;
+	int *binCommands;
+	int binCommandsSize;
+} DrawCommandList;
+#define DRAW_BIN_WIDTH 64
+#define DRAW_BIN_HEIGHT 48
+
+// Everything a viewport is drawn with. Nothing here is shared with other
+// viewports, so split screen viewports can be drawn on separate threads.
+typedef struct
+{
+	// Copy of the graphics device, sharing its buffer, with the viewport's
+	// clipping rectangle; the viewport's blits go through this
+	GraphicsDevice device;
+	// The viewport's tiles, their dimensions and line of sight
+	DrawBuffer buffer;
+	DisplayList displayList;
+	DrawCommandList commandList;
+} DrawContext;
+
+void DrawContextInit(DrawContext *c, Vec2i tiles);
+void DrawContextTerminate(DrawContext *c);
+// Target the device, clipped to the rectangle
+void DrawContextSetDevice(
+	DrawContext *c, const GraphicsDevice *device,
+	int left, int top, int right, int bottom);
+
+// Hide floors under walls, and set the line of sight flags of the tiles
+// Also marks tiles as visited and characters as seen, so it is not safe to
+// call for several viewports at once, unlike DrawBufferDraw
+void FixBuffer(DrawBuffer *b, const FOVBits *visible);
+void DrawBufferDraw(DrawContext *c, Vec2i offset);
+// Like DrawBufferDraw, but the blits are recorded and binned instead, to be
+// drawn with DrawContextDrawBin. Draws the same pixels as DrawBufferDraw
+// once all the bins are drawn. Since each bin only draws within its own
+// screen tile, the bins can be drawn concurrently.
+void DrawBufferRecord(DrawContext *c, Vec2i offset);
+int DrawContextGetBinCount(const DrawContext *c);
+void DrawCommandRun(const DrawCommand *cmd, GraphicsDevice *device);
+void DrawContextDrawBin(DrawContext *c, int bin);
 void DisplayPlayer(int x, const char *name, Character *c, int editingName);
 void DisplayCharacter(int x, int y, Character *c, int hilite, int showGun);
 void DrawCharacterSimple(
@@ -48,30 +48,25 @@
 */
 #include "draw_buffer.h"
 
+#include <string.h>
+
 void DrawBufferInit(DrawBuffer *b, Vec2i size)
 {
-	int i;
-	CMALLOC(b->tiles, size.x * sizeof *b->tiles);
-	CMALLOC(b->tiles[0], size.x * size.y * sizeof *b->tiles[0]);
-	for(i = 1; i < size.x; i++)
-	{
-		b->tiles[i] = b->tiles[0] + i * size.y;
-	}
+	b->map = NULL;
+	b->size = size;
+	CCALLOC(b->flags, size.x * size.y);
 }
 void DrawBufferTerminate(DrawBuffer *b)
 {
-	CFREE(b->tiles[0]);
-	CFREE(b->tiles);
+	CFREE(b->flags);
 }
 
 void DrawBufferSetFromMap(
 	DrawBuffer *buffer, Tile map[YMAX][XMAX], Vec2i origin,
 	int width, Vec2i tilesXY)
 {
-	int x, y;
-	Tile *bufTile;
-
 	buffer->width = width;
+	buffer->height = tilesXY.y;
 
 	buffer->xTop = origin.x - TILE_WIDTH * width / 2;
 	//buffer->yTop = y_origin - 100;
@@ -91,22 +86,6 @@ void DrawBufferSetFromMap(
 	buffer->dx = buffer->xStart * TILE_WIDTH - buffer->xTop;
 	buffer->dy = buffer->yStart * TILE_HEIGHT - buffer->yTop;
 
-	bufTile = &buffer->tiles[0][0];
-	for (y = buffer->yStart; y < buffer->yStart + tilesXY.y; y++)
-	{
-		for (x = buffer->xStart;
-			x < buffer->xStart + buffer->width;
-			x++, bufTile++)
-		{
-			if (x >= 0 && x < XMAX && y >= 0 && y < YMAX)
-			{
-				*bufTile = map[y][x];
-			}
-			else
-			{
-				*bufTile = tileNone;
-			}
-		}
-		bufTile += tilesXY.x - buffer->width;
-	}
+	buffer->map = map;
+	memset(buffer->flags, 0, buffer->size.x * buffer->size.y);
 }
@@ -50,16 +50,58 @@
 #define __DRAW_BUFFER
 
 #include "map.h"
+#include "tile_item_index.h"
 
+// Per-frame tile state, kept in an overlay so the map is never copied
+typedef enum
+{
+	DRAW_TILE_OUT_OF_SIGHT	= 0x01,
+	// Wall drawn as part of the column of the wall below it
+	DRAW_TILE_DELAY_DRAW	= 0x02,
+	// Floor covered by the wall below it
+	DRAW_TILE_NO_FLOOR		= 0x04,
+	// Floor that walls or doors are drawn all over, so it isn't drawn
+	DRAW_TILE_FLOOR_HIDDEN	= 0x08
+} DrawTileFlags;
+
+// A view of the map's tiles around a point
+// Tiles are read from the map directly; tiles outside the map are tileNone
 typedef struct
 {
 	int xTop, yTop;
 	int xStart, yStart;
 	int dx, dy;
 	int width;
-	Tile **tiles;
+	int height;
+	Tile (*map)[XMAX];
+	Vec2i size;
+	unsigned char *flags;
 } DrawBuffer;
 
+static INLINE Tile *DrawBufferGetTile(const DrawBuffer *b, int x, int y)
+{
+	x += b->xStart;
+	y += b->yStart;
+	if (x < 0 || x >= XMAX || y < 0 || y >= YMAX)
+	{
+		return &tileNone;
+	}
+	return &b->map[y][x];
+}
+static INLINE int DrawBufferIsVisited(const DrawBuffer *b, int x, int y)
+{
+	return MapIsVisited(x + b->xStart, y + b->yStart);
+}
+static INLINE const TileItemCell *DrawBufferGetItems(
+	const DrawBuffer *b, int x, int y)
+{
+	return TileItemIndexGetCell(x + b->xStart, y + b->yStart);
+}
+static INLINE unsigned char *DrawBufferGetFlags(DrawBuffer *b, int x, int y)
+{
+	return &b->flags[y * b->size.x + x];
+}
+
 void DrawBufferInit(DrawBuffer *b, Vec2i size);
 void DrawBufferTerminate(DrawBuffer *b);
 
@@ -74,13 +74,13 @@ void Draw_Point(const int x, const int y, color_t c)
 	}
 	if (c.a == 255)
 	{
-		screen[index] = PixelFromColor(&gGraphicsDevice, c);
+		screen[index] = PixelFromColor(c);
 	}
 	else
 	{
-		color_t existing = PixelToColor(&gGraphicsDevice, screen[index]);
+		color_t existing = PixelToColor(screen[index]);
 		screen[index] =
-			PixelFromColor(&gGraphicsDevice, ColorAlphaBlend(existing, c));
+			PixelFromColor(ColorAlphaBlend(existing, c));
 	}
 }
 
@@ -178,12 +178,20 @@ void DrawPointMask(GraphicsDevice *device, Vec2i pos, color_t mask)
 	{
 		return;
 	}
-	c = PixelToColor(device, screen[idx]);
+	c = PixelToColor(screen[idx]);
 	c = ColorMult(c, mask);
-	screen[idx] = PixelFromColor(device, c);
+	screen[idx] = PixelFromColor(c);
 }
 
 void DrawPointTint(GraphicsDevice *device, Vec2i pos, HSV tint)
+{
+	TintFixed t;
+	TintFixedInit(&t, tint);
+	DrawPointTintFixed(device, pos, &t);
+}
+
+void DrawPointTintFixed(
+	GraphicsDevice *device, Vec2i pos, const TintFixed *tint)
 {
 	Uint32 *screen = device->buf;
 	int idx = PixelIndex(
@@ -191,14 +199,18 @@ void DrawPointTint(GraphicsDevice *device, Vec2i pos, HSV tint)
 		device->cachedConfig.ResolutionWidth,
 		device->cachedConfig.ResolutionHeight);
 	color_t c;
+	if (BlitMeasure(device, pos, Vec2iNew(1, 1)))
+	{
+		return;
+	}
 	if (pos.x < device->clipping.left || pos.x > device->clipping.right ||
 		pos.y < device->clipping.top || pos.y > device->clipping.bottom)
 	{
 		return;
 	}
-	c = PixelToColor(device, screen[idx]);
-	c = ColorTint(c, tint);
-	screen[idx] = PixelFromColor(device, c);
+	c = PixelToColor(screen[idx]);
+	c = ColorTintFixed(c, tint);
+	screen[idx] = PixelFromColor(c);
 }
 
 void DrawRectangle(
@@ -245,7 +257,7 @@ void DrawRectangle(
 void DrawCross(GraphicsDevice *device, int x, int y, color_t color)
 {
 	Uint32 *screen = device->buf;
-	Uint32 pixel = PixelFromColor(device, color);
+	Uint32 pixel = PixelFromColor(color);
 	screen += x;
 	screen += y * gGraphicsDevice.cachedConfig.ResolutionWidth;
 	*screen = pixel;
@@ -259,13 +271,18 @@ void DrawShadow(GraphicsDevice *device, Vec2i pos, Vec2i size)
 {
 	Vec2i drawPos;
 	HSV tint = { -1.0, 1.0, 0.0 };
-	if (!gConfig.Game.Shadows)
+	TintFixed t;
+	if (!gConfig.Game.Shadows ||
+		BlitMeasure(
+			device, Vec2iAdd(pos, Vec2iScale(size, -1)), Vec2iScale(size, 2)))
 	{
 		return;
 	}
+	// Only the value changes from pixel to pixel
+	TintFixedInit(&t, tint);
 	for (drawPos.y = pos.y - size.y; drawPos.y < pos.y + size.y; drawPos.y++)
 	{
-		if (drawPos.y >= device->clipping.bottom)
+		if (drawPos.y > device->clipping.bottom)
 		{
 			break;
 		}
@@ -278,7 +295,7 @@ void DrawShadow(GraphicsDevice *device, Vec2i pos, Vec2i size)
 			// Calculate value tint based on distance from center
 			Vec2i scaledPos;
 			int distance2;
-			if (drawPos.x >= device->clipping.right)
+			if (drawPos.x > device->clipping.right)
 			{
 				break;
 			}
@@ -291,7 +308,8 @@ void DrawShadow(GraphicsDevice *device, Vec2i pos, Vec2i size)
 			distance2 = DistanceSquared(scaledPos, pos);
 			// Maximum distance is x, so scale distance squared by x squared
 			tint.v = CLAMP(distance2 * 1.0 / (size.x*size.x), 0.0, 1.0);
-			DrawPointTint(device, drawPos, tint);
+			TintFixedSetValue(&t, tint);
+			DrawPointTintFixed(device, drawPos, &t);
 		}
 	}
 }
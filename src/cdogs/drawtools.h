@@ -66,6 +66,9 @@ void Draw_Line(
 
 void DrawPointMask(GraphicsDevice *device, Vec2i pos, color_t mask);
 void DrawPointTint(GraphicsDevice *device, Vec2i pos, HSV tint);
+// As DrawPointTint, for drawing many points with one tint
+void DrawPointTintFixed(
+	GraphicsDevice *device, Vec2i pos, const TintFixed *tint);
 
 typedef enum
 {
@@ -0,0 +1,135 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "floor_layer.h"
+
+#include <string.h>
+
+#include "blit.h"
+#include "map.h"
+#include "tile_cache.h"
+#include "utils.h"
+
+FloorLayer gFloorLayer = { NULL, { 0, 0 }, { 0, 0 } };
+
+
+void FloorLayerInit(FloorLayer *fl, Vec2i origin, Vec2i size)
+{
+	Vec2i v;
+	FloorLayerTerminate(fl);
+	fl->origin = origin;
+	fl->size = size;
+	CMALLOC(
+		fl->pixels,
+		size.x * TILE_WIDTH * size.y * TILE_HEIGHT * sizeof *fl->pixels);
+	for (v.y = origin.y; v.y < origin.y + size.y; v.y++)
+	{
+		for (v.x = origin.x; v.x < origin.x + size.x; v.x++)
+		{
+			FloorLayerUpdateTile(fl, v);
+		}
+	}
+}
+
+void FloorLayerTerminate(FloorLayer *fl)
+{
+	CFREE(fl->pixels);
+	fl->pixels = NULL;
+	fl->size = Vec2iZero();
+}
+
+void FloorLayerUpdateTile(FloorLayer *fl, Vec2i tile)
+{
+	const int stride = fl->size.x * TILE_WIDTH;
+	Tile *t;
+	const Uint32 *pixels = NULL;
+	Uint32 *target;
+	Vec2i size = Vec2iZero();
+	int y;
+	tile = Vec2iNew(tile.x - fl->origin.x, tile.y - fl->origin.y);
+	if (tile.x < 0 || tile.x >= fl->size.x ||
+		tile.y < 0 || tile.y >= fl->size.y)
+	{
+		return;
+	}
+	t = &Map(tile.x + fl->origin.x, tile.y + fl->origin.y);
+	if (!(t->flags & (MAPTILE_IS_WALL | MAPTILE_OFFSET_PIC)) &&
+		t->pic != NULL)
+	{
+		pixels = TileCacheGetPixels(&gTileCache, t->pic, 0);
+		if (pixels != NULL)
+		{
+			size.x = MIN(t->pic->size.x, TILE_WIDTH);
+			size.y = MIN(t->pic->size.y, TILE_HEIGHT);
+		}
+	}
+	target = fl->pixels + tile.y * TILE_HEIGHT * stride + tile.x * TILE_WIDTH;
+	for (y = 0; y < TILE_HEIGHT; y++, target += stride)
+	{
+		int x = 0;
+		if (y < size.y)
+		{
+			memcpy(
+				target, pixels + y * t->pic->size.x, size.x * sizeof *target);
+			x = size.x;
+		}
+		for (; x < TILE_WIDTH; x++)
+		{
+			target[x] = PixelFromColor(colorBlack);
+		}
+	}
+}
+
+void FloorLayerDraw(
+	FloorLayer *fl, GraphicsDevice *device,
+	Vec2i start, Vec2i count, Vec2i pos)
+{
+	Vec2i end = Vec2iAdd(start, count);
+	// Intersect with the layer
+	Vec2i first = Vec2iNew(
+		MAX(start.x, fl->origin.x), MAX(start.y, fl->origin.y));
+	Vec2i last = Vec2iNew(
+		MIN(end.x, fl->origin.x + fl->size.x),
+		MIN(end.y, fl->origin.y + fl->size.y));
+	const int stride = fl->size.x * TILE_WIDTH;
+	if (fl->pixels == NULL || first.x >= last.x || first.y >= last.y)
+	{
+		return;
+	}
+	BlitPixels(
+		device,
+		fl->pixels +
+		(first.y - fl->origin.y) * TILE_HEIGHT * stride +
+		(first.x - fl->origin.x) * TILE_WIDTH,
+		stride,
+		Vec2iNew(
+			(last.x - first.x) * TILE_WIDTH, (last.y - first.y) * TILE_HEIGHT),
+		Vec2iNew(
+			pos.x + (first.x - start.x) * TILE_WIDTH,
+			pos.y + (first.y - start.y) * TILE_HEIGHT));
+}
@@ -0,0 +1,61 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __FLOOR_LAYER
+#define __FLOOR_LAYER
+
+#include "grafx.h"
+#include "vector.h"
+
+// Pre-rendered floor tiles for the whole level, at full visibility
+// Floor tiles only change through ChangeFloor and tile-changing triggers,
+// which re-render just those tiles, so drawing the floor is a rectangle copy
+// followed by a pass for the fogged and unseen tiles.
+// Wall and door tiles are black in the layer; floor pics are tile-sized so
+// each tile is rendered clipped to its own cell.
+typedef struct
+{
+	Uint32 *pixels;
+	// In tiles
+	Vec2i origin;
+	Vec2i size;
+} FloorLayer;
+
+extern FloorLayer gFloorLayer;
+
+// Render the tiles in the map area starting at origin
+void FloorLayerInit(FloorLayer *fl, Vec2i origin, Vec2i size);
+void FloorLayerTerminate(FloorLayer *fl);
+// Re-render a map tile after its pic or flags have changed
+void FloorLayerUpdateTile(FloorLayer *fl, Vec2i tile);
+// Draw the layer's part of count tiles from start, with start drawn at pos
+void FloorLayerDraw(
+	FloorLayer *fl, GraphicsDevice *device,
+	Vec2i start, Vec2i count, Vec2i pos);
+
+#endif
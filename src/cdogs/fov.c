@@ -0,0 +1,186 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "fov.h"
+
+#include <string.h>
+
+FOV gPlayerFOV[MAX_PLAYERS];
+
+// Bumped whenever the map's opacity changes, to invalidate cached FOVs
+static int sGeneration = 1;
+
+
+void FOVBitsClear(FOVBits *b)
+{
+	memset(b->bits, 0, sizeof b->bits);
+}
+void FOVBitsOr(FOVBits *dst, const FOVBits *src)
+{
+	int i;
+	for (i = 0; i < FOV_WORDS; i++)
+	{
+		dst->bits[i] |= src->bits[i];
+	}
+}
+
+void FOVMapChanged(void)
+{
+	sGeneration++;
+}
+
+static int IsInMap(Vec2i tile)
+{
+	return tile.x >= 0 && tile.x < XMAX && tile.y >= 0 && tile.y < YMAX;
+}
+static int IsOpaque(Vec2i tile)
+{
+	return MapBitsGet(&gMapNoSee, tile.x, tile.y);
+}
+
+typedef struct
+{
+	FOVBits *visible;
+	Vec2i origin;
+	int radius;
+	int range2;
+	// Octant transform
+	int xx, xy, yx, yy;
+} ShadowCast;
+
+// Scan one octant, row by row outwards from the origin, between the start
+// and end slopes; opaque tiles split the scan and cast shadows
+static void CastLight(ShadowCast *s, int row, double start, double end)
+{
+	int j;
+	if (start < end)
+	{
+		return;
+	}
+	for (j = row; j <= s->radius; j++)
+	{
+		int dx = -j - 1;
+		const int dy = -j;
+		int blocked = 0;
+		double newStart = 0;
+		while (dx <= 0)
+		{
+			double leftSlope, rightSlope;
+			Vec2i tile;
+			dx++;
+			tile.x = s->origin.x + dx * s->xx + dy * s->xy;
+			tile.y = s->origin.y + dx * s->yx + dy * s->yy;
+			leftSlope = (dx - 0.5) / (dy + 0.5);
+			rightSlope = (dx + 0.5) / (dy - 0.5);
+			if (start < rightSlope)
+			{
+				continue;
+			}
+			if (end > leftSlope)
+			{
+				break;
+			}
+			if ((s->range2 == 0 || dx * dx + dy * dy < s->range2) &&
+				IsInMap(tile))
+			{
+				FOVBitsSet(s->visible, tile);
+			}
+			if (blocked)
+			{
+				if (IsOpaque(tile))
+				{
+					newStart = rightSlope;
+					continue;
+				}
+				blocked = 0;
+				start = newStart;
+			}
+			else if (IsOpaque(tile) && j < s->radius)
+			{
+				blocked = 1;
+				CastLight(s, j + 1, start, leftSlope);
+				newStart = rightSlope;
+			}
+		}
+		if (blocked)
+		{
+			break;
+		}
+	}
+}
+
+static void Compute(FOV *fov)
+{
+	// Transforms from octant coordinates to map coordinates
+	static const int octants[8][4] =
+	{
+		{ 1, 0, 0, 1 }, { 0, 1, 1, 0 }, { 0, -1, 1, 0 }, { -1, 0, 0, 1 },
+		{ -1, 0, 0, -1 }, { 0, -1, -1, 0 }, { 0, 1, -1, 0 }, { 1, 0, 0, -1 }
+	};
+	ShadowCast s;
+	Vec2i v;
+	int i;
+	FOVBitsClear(&fov->visible);
+	s.visible = &fov->visible;
+	s.origin = fov->origin;
+	s.radius = fov->range > 0 ? fov->range : MAX(XMAX, YMAX);
+	s.range2 = fov->range * fov->range;
+	for (i = 0; i < 8; i++)
+	{
+		s.xx = octants[i][0];
+		s.xy = octants[i][1];
+		s.yx = octants[i][2];
+		s.yy = octants[i][3];
+		CastLight(&s, 1, 1.0, 0.0);
+	}
+	// The tile and all adjacent tiles are always visible
+	for (v.y = fov->origin.y - 1; v.y <= fov->origin.y + 1; v.y++)
+	{
+		for (v.x = fov->origin.x - 1; v.x <= fov->origin.x + 1; v.x++)
+		{
+			if (IsInMap(v))
+			{
+				FOVBitsSet(&fov->visible, v);
+			}
+		}
+	}
+}
+
+const FOVBits *FOVUpdate(FOV *fov, Vec2i origin, int range)
+{
+	if (fov->generation != sGeneration ||
+		!Vec2iEqual(fov->origin, origin) ||
+		fov->range != range)
+	{
+		fov->origin = origin;
+		fov->range = range;
+		fov->generation = sGeneration;
+		Compute(fov);
+	}
+	return &fov->visible;
+}
@@ -0,0 +1,81 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __FOV
+#define __FOV
+
+#include <stdint.h>
+
+#include "character.h"
+#include "map.h"
+#include "vector.h"
+
+// Field of view using recursive shadowcasting over the map's MAPTILE_NO_SEE
+// bitboard. Results are cached per viewer and only recomputed when the
+// viewer changes tile or the map's opacity changes.
+
+#define FOV_WORDS ((XMAX * YMAX + 31) / 32)
+
+// One bit per map tile
+typedef struct
+{
+	uint32_t bits[FOV_WORDS];
+} FOVBits;
+
+typedef struct
+{
+	FOVBits visible;
+	Vec2i origin;
+	int range;
+	int generation;
+} FOV;
+
+// Player FOVs, shared by drawing and AI
+extern FOV gPlayerFOV[MAX_PLAYERS];
+
+static INLINE int FOVBitsGet(const FOVBits *b, Vec2i tile)
+{
+	const int i = tile.y * XMAX + tile.x;
+	return (b->bits[i >> 5] >> (i & 31)) & 1;
+}
+static INLINE void FOVBitsSet(FOVBits *b, Vec2i tile)
+{
+	const int i = tile.y * XMAX + tile.x;
+	b->bits[i >> 5] |= 1u << (i & 31);
+}
+void FOVBitsClear(FOVBits *b);
+void FOVBitsOr(FOVBits *dst, const FOVBits *src);
+
+// Invalidate all FOVs, for when the map's opacity bits have changed
+void FOVMapChanged(void);
+
+// Get the tiles visible from a tile, within range tiles (0 for unlimited)
+// The tile and its neighbours are always visible
+const FOVBits *FOVUpdate(FOV *fov, Vec2i origin, int range);
+
+#endif
@@ -60,6 +60,7 @@
 #include "actors.h"
 #include "ai.h"
 #include "blit.h"
+#include "blit_simd.h"
 #include "config.h"
 #include "defs.h"
 #include "draw.h"
@@ -194,7 +195,12 @@ void GraphicsInit(GraphicsDevice *device)
 	AddGraphicsMode(device, 320, 240, 2);
 	device->buf = NULL;
 	device->bkg = NULL;
+	device->presentBuf = NULL;
+	device->measure = NULL;
+	PaletteInit();
 	hqxInit();
+	BlitRowKernelsInit();
+	debug(D_NORMAL, "blit SIMD: %s\n", BlitSIMDStr(BlitSIMDDetect()));
 }
 
 void AddSupportedModesForBPP(GraphicsDevice *device, int bpp)
@@ -299,6 +305,14 @@ void GraphicsInitialize(
 		sdl_flags |= SDL_FULLSCREEN;
 	}
 
+	// The scalers only support 1x to 4x; forced modes skip the mode list, so
+	// the factor straight from the config or command line is checked here
+	if (config->ScaleFactor < 1 || config->ScaleFactor > 4)
+	{
+		printf("!!! Invalid scale factor %d\n", config->ScaleFactor);
+		config->ScaleFactor = CLAMP(config->ScaleFactor, 1, 4);
+	}
+
 	rw = w = config->ResolutionWidth;
 	rh = h = config->ResolutionHeight;
 
@@ -328,6 +342,8 @@ void GraphicsInitialize(
 
 	printf("Graphics mode:\t%dx%d %dx (actual %dx%d)\n",
 		w, h, config->ScaleFactor, rw, rh);
+	// The present thread may still be using the screen and buffers
+	BlitFlipFlush();
 	SDL_FreeSurface(device->screen);
 	device->screen = SDL_SetVideoMode(rw, rh, 32, sdl_flags);
 	if (device->screen == NULL)
@@ -340,6 +356,8 @@ void GraphicsInitialize(
 	CCALLOC(device->buf, GraphicsGetMemSize(config));
 	CFREE(device->bkg);
 	CCALLOC(device->bkg, GraphicsGetMemSize(config));
+	CFREE(device->presentBuf);
+	CCALLOC(device->presentBuf, GraphicsGetMemSize(config));
 
 	debug(D_NORMAL, "Changed video mode...\n");
 
@@ -362,10 +380,13 @@ void GraphicsInitialize(
 void GraphicsTerminate(GraphicsDevice *device)
 {
 	debug(D_NORMAL, "Shutting down video...\n");
+	BlitTerminate();
+	PaletteTerminate();
 	SDL_FreeSurface(device->screen);
 	SDL_VideoQuit();
 	CFREE(device->buf);
 	CFREE(device->bkg);
+	CFREE(device->presentBuf);
 }
 
 int GraphicsGetScreenSize(GraphicsConfig *config)
@@ -381,31 +402,36 @@ int GraphicsGetMemSize(GraphicsConfig *config)
 void GrafxMakeBackground(
 	GraphicsDevice *device, GraphicsConfig *config, HSV tint, int missionIdx)
 {
-	DrawBuffer buffer;
+	DrawContext c;
 	Vec2i v;
+	TintFixed t;
 
-	DrawBufferInit(&buffer, Vec2iNew(128, 128));
+	DrawContextInit(&c, Vec2iNew(128, 128));
 	SetupMission(missionIdx, 1, &gCampaign);
 	SetupMap();
 	InitializeBadGuys();
 	CreateEnemies();
 	MapMarkAllAsVisited();
 	DrawBufferSetFromMap(
-		&buffer, gMap,
+		&c.buffer, gMap,
 		Vec2iNew(1024, 768),
 		X_TILES,
 		Vec2iNew(X_TILES, Y_TILES));
-	DrawBufferDraw(&buffer, Vec2iZero());
-	DrawBufferTerminate(&buffer);
+	DrawContextSetDevice(
+		&c, device,
+		0, 0, config->ResolutionWidth - 1, config->ResolutionHeight - 1);
+	DrawBufferDraw(&c, Vec2iZero());
+	DrawContextTerminate(&c);
 	KillAllActors();
 	KillAllObjects();
 	FreeTriggersAndWatches();
 
+	TintFixedInit(&t, tint);
 	for (v.y = 0; v.y < config->ResolutionHeight; v.y++)
 	{
 		for (v.x = 0; v.x < config->ResolutionWidth; v.x++)
 		{
-			DrawPointTint(device, v, tint);
+			DrawPointTintFixed(device, v, &t);
 		}
 	}
 	memcpy(device->bkg, device->buf, GraphicsGetMemSize(config));
@@ -71,6 +71,14 @@ typedef struct
 	int ScaleFactor;
 	int ShakeMultiplier;
 	ScaleMode ScaleMode;
+	// In KB
+	int CharacterCacheSize;
+	// Horizontal bands the scalers split the frame into, each scaled on its
+	// own thread; 0 for one per CPU
+	int ScaleBands;
+	// Scale and present each game frame on another thread while the next is
+	// drawn; off for lowest latency
+	int PipelinedPresent;
 } GraphicsConfig;
 
 typedef struct
@@ -100,6 +108,11 @@ typedef struct
 	int modeIndex;
 	Uint32 *buf;
 	Uint32 *bkg;
+	// Copy of buf being presented by BlitFlipAsync
+	Uint32 *presentBuf;
+	// If set, blits aren't drawn; instead this is grown to cover the pixels
+	// they would have drawn, clipped (see BlitMeasure)
+	BlitClipping *measure;
 } GraphicsDevice;
 
 extern GraphicsDevice gGraphicsDevice;
@@ -331,7 +331,6 @@ static void DrawRadar(GraphicsDevice *device, TActor *p, int scale, int flags)
 		Vec2i playerPos = Vec2iNew(
 			p->tileItem.x / TILE_WIDTH, p->tileItem.y / TILE_HEIGHT);
 		AutomapDrawRegion(
-			gMap,
 			pos,
 			Vec2iNew(AUTOMAP_SIZE, AUTOMAP_SIZE),
 			playerPos,
@@ -349,7 +348,6 @@ static void DrawSharedRadar(
 	playerMidpoint.x /= TILE_WIDTH;
 	playerMidpoint.y /= TILE_HEIGHT;
 	AutomapDrawRegion(
-		gMap,
 		pos,
 		Vec2iNew(AUTOMAP_SIZE, AUTOMAP_SIZE),
 		playerMidpoint,
@@ -407,7 +405,7 @@ static void DrawPlayerStatus(
 static void DrawKeycard(int x, int y, const TOffsetPic * pic)
 {
 	DrawTPic(
-		x + pic->dx, y + pic->dy,
+		&gGraphicsDevice, x + pic->dx, y + pic->dy,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
@@ -51,10 +51,15 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "automap.h"
 #include "collision.h"
 #include "config.h"
+#include "floor_layer.h"
+#include "fov.h"
 #include "pic_manager.h"
 #include "objs.h"
+#include "tile_cache.h"
+#include "tile_item_index.h"
 #include "triggers.h"
 #include "sounds.h"
 #include "actors.h"
@@ -79,8 +84,11 @@
 #define MAP_ACCESSBITS      0x0F00
 
 
-Tile tileNone = { NULL, { { 0, 0 }, { 0, 0 }, NULL }, 0, 0, NULL };
+Tile tileNone = { NULL, { { 0, 0 }, { 0, 0 }, NULL, NULL }, 0 };
 Tile gMap[YMAX][XMAX];
+MapBits gMapNoWalk;
+MapBits gMapNoSee;
+MapBits gMapVisited;
 
 
 static int gKeyAccessCount;
@@ -89,36 +97,76 @@ static int tilesSeen = 0;
 static int tilesTotal = XMAX * YMAX;
 #define iMap( x, y) internalMap[y][x]
 
-static void AddItemToTile(TTileItem * t, Tile * tile)
+int MapBitsAny(const MapBits *b, Vec2i min, Vec2i max)
 {
-	t->next = tile->things;
-	tile->things = t;
+	int y;
+	if (min.x < 0 || max.x >= XMAX || min.y < 0 || max.y >= YMAX)
+	{
+		return 1;
+	}
+	for (y = min.y; y <= max.y; y++)
+	{
+		int w;
+		for (w = min.x >> 6; w <= max.x >> 6; w++)
+		{
+			// The columns of the rectangle in this word
+			const int lo = MAX(min.x - w * 64, 0);
+			const int hi = MIN(max.x - w * 64, 63);
+			const uint64_t mask =
+				(hi == 63 ? ~(uint64_t)0 : ((uint64_t)1 << (hi + 1)) - 1) &
+				~(((uint64_t)1 << lo) - 1);
+			if (b->rows[y][w] & mask)
+			{
+				return 1;
+			}
+		}
+	}
+	return 0;
 }
 
-static void RemoveItemFromTile(TTileItem * t, Tile * tile)
+static int SetBit(MapBits *b, Vec2i tile, int isSet)
 {
-	TTileItem **h = &tile->things;
+	uint64_t *word = &b->rows[tile.y][tile.x >> 6];
+	const uint64_t bit = (uint64_t)1 << (tile.x & 63);
+	if (!!(*word & bit) == isSet)
+	{
+		return 0;
+	}
+	*word ^= bit;
+	return 1;
+}
 
-	while (*h && *h != t)
-		h = &(*h)->next;
-	if (*h) {
-		*h = t->next;
-		t->next = NULL;
+void MapBitsInit(void)
+{
+	Vec2i v;
+	memset(&gMapNoWalk, 0, sizeof gMapNoWalk);
+	memset(&gMapNoSee, 0, sizeof gMapNoSee);
+	for (v.y = 0; v.y < YMAX; v.y++)
+	{
+		for (v.x = 0; v.x < XMAX; v.x++)
+		{
+			MapBitsUpdateTile(v);
+		}
 	}
 }
 
-Tile *MapGetTileOfItem(TTileItem *t)
+int MapBitsUpdateTile(Vec2i tile)
 {
-	Tile *tile;
-	int x = t->x / TILE_WIDTH;
-	int y = t->y / TILE_HEIGHT;
-	tile = &gMap[y][x];
-	return tile;
+	const int flags = Map(tile.x, tile.y).flags;
+	int changed = 0;
+	if (SetBit(&gMapNoWalk, tile, !!(flags & MAPTILE_NO_WALK)))
+	{
+		changed |= MAPTILE_NO_WALK;
+	}
+	if (SetBit(&gMapNoSee, tile, !!(flags & MAPTILE_NO_SEE)))
+	{
+		changed |= MAPTILE_NO_SEE;
+	}
+	return changed;
 }
 
 void MoveTileItem(TTileItem * t, int x, int y)
 {
-	Tile *tile;
 	int x1 = t->x / TILE_WIDTH;
 	int y1 = t->y / TILE_HEIGHT;
 	int x2 = x / TILE_WIDTH;
@@ -126,19 +174,21 @@ void MoveTileItem(TTileItem * t, int x, int y)
 
 	t->x = x;
 	t->y = y;
-	if (x1 == x2 && y1 == y2)
+	CollisionBatchMoveItem(t);
+	if (t->cell != NULL && x1 == x2 && y1 == y2)
+	{
+		TileItemIndexUpdate(t);
 		return;
+	}
 
-	tile = &Map(x1, y1);
-	RemoveItemFromTile(t, tile);
-	tile = &Map(x2, y2);
-	AddItemToTile(t, tile);
+	TileItemIndexRemove(t);
+	TileItemIndexAdd(t);
 }
 
 void RemoveTileItem(TTileItem * t)
 {
-	Tile *tile = MapGetTileOfItem(t);
-	RemoveItemFromTile(t, tile);
+	TileItemIndexRemove(t);
+	CollisionBatchRemoveItem(t);
 }
 
 void GuessCoords(int *x, int *y)
@@ -565,6 +615,7 @@ void ChangeFloor(int x, int y, int normal, int shadow)
 		{
 			Map(x, y).pic = PicManagerGetFromOld(&gPicManager, normal);
 		}
+		FloorLayerUpdateTile(&gFloorLayer, Vec2iNew(x, y));
 		break;
 	}
 }
@@ -647,7 +698,7 @@ static int PlaceOneObject(int x, int y, TMapObject * mo, int extraFlags)
 	int tileFlags = 0;
 
 	if ((Map(x, y).flags & ~MAPTILE_IS_NORMAL_FLOOR) ||
-		Map(x, y).things != NULL ||
+		TileItemIndexGetCell(x, y)->count > 0 ||
 		(iMap(x, y) & MAP_LEAVEFREE))
 	{
 		return 0;
@@ -799,11 +850,11 @@ static void PlaceCard(int pic, int card, int map_access)
 		GuessCoords(&x, &y);
 		if (y < YMAX - 1 &&
 			!(Map(x, y).flags & ~MAPTILE_IS_NORMAL_FLOOR) &&
-			Map(x, y).things == NULL &&
+			TileItemIndexGetCell(x, y)->count == 0 &&
 			(iMap(x, y) & 0xF00) == map_access &&
 			(iMap(x, y) & MAP_MASKACCESS) == MAP_ROOM &&
 			!(Map(x, y + 1).flags & ~MAPTILE_IS_NORMAL_FLOOR) &&
-			Map(x, y + 1).things == NULL)
+			TileItemIndexGetCell(x, y + 1)->count == 0)
 		{
 			AddObject(
 				(x * TILE_WIDTH + TILE_WIDTH / 2) << 8,
@@ -1179,6 +1230,31 @@ void SetupPerimeter(int w, int h)
 
 }
 
+static void CacheActionTiles(TAction *a, void *data)
+{
+	UNUSED(data);
+	if (a->action == ACTION_CHANGETILE)
+	{
+		TileCacheAdd(&gTileCache, a->tilePic);
+		TileCacheAdd(&gTileCache, &a->tilePicAlt);
+	}
+}
+// Cache every pic that tiles can have, including those that doors change
+// to, so that drawing never adds to the cache
+static void CacheTiles(void)
+{
+	int x, y;
+	for (y = 0; y < YMAX; y++)
+	{
+		for (x = 0; x < XMAX; x++)
+		{
+			TileCacheAdd(&gTileCache, Map(x, y).pic);
+			TileCacheAdd(&gTileCache, &Map(x, y).picAlt);
+		}
+	}
+	ForEachTriggerAction(CacheActionTiles, NULL);
+}
+
 void SetupMap(void)
 {
 	int i, j, count;
@@ -1189,7 +1265,10 @@ void SetupMap(void)
 	int x, y, w, h;
 
 	PicManagerGenerateOldPics(&gPicManager);
+	// The old pics have just been regenerated, so the cached tiles are stale
+	TileCacheClear(&gTileCache);
 	memset(gMap, 0, sizeof(gMap));
+	TileItemIndexClear();
 	for (y = 0; y < YMAX; y++)
 	{
 		for (x = 0; x < XMAX; x++)
@@ -1199,6 +1278,7 @@ void SetupMap(void)
 		}
 	}
 	memset(internalMap, 0, sizeof(internalMap));
+	memset(&gMapVisited, 0, sizeof gMapVisited);
 	tilesSeen = 0;
 
 	w = mission->mapWidth
@@ -1241,6 +1321,10 @@ void SetupMap(void)
 
 	FixMap(floor, room, wall);
 	FixDoors(floor, room);
+	// The walls and doors are in place; objects are placed by collision
+	MapBitsInit();
+	CacheTiles();
+	FloorLayerInit(&gFloorLayer, Vec2iNew(x, y), Vec2iNew(w, h));
 
 	for (i = 0; i < gMission.objectCount; i++)
 		for (j = 0;
@@ -1288,6 +1372,9 @@ void SetupMap(void)
 	{
 		PlaceCard(0, OBJ_KEYCARD_YELLOW, 0);
 	}
+
+	FOVMapChanged();
+	AutomapInit();
 }
 
 int OKforPlayer(int x, int y)
@@ -1297,23 +1384,17 @@ int OKforPlayer(int x, int y)
 
 void MapMarkAsVisited(Vec2i pos)
 {
-	if (!Map(pos.x, pos.y).isVisited)
+	if (SetBit(&gMapVisited, pos, 1))
 	{
 		tilesSeen++;
-		Map(pos.x, pos.y).isVisited = 1;
+		AutomapUpdateTile(pos);
 	}
 }
 
 void MapMarkAllAsVisited(void)
 {
-	Vec2i pos;
-	for (pos.y = 0; pos.y < YMAX; pos.y++)
-	{
-		for (pos.x = 0; pos.x < XMAX; pos.x++)
-		{
-			Map(pos.x, pos.y).isVisited = 1;
-		}
-	}
+	memset(&gMapVisited, 0xff, sizeof gMapVisited);
+	AutomapInit();
 }
 
 int ExploredPercentage(void)
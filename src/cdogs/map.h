@@ -49,6 +49,9 @@
 #ifndef __MAP
 #define __MAP
 
+#include <stdint.h>
+
+#include "grafx.h"
 #include "pic.h"
 #include "vector.h"
 
@@ -69,16 +72,12 @@ typedef enum
 	MAPTILE_NO_WALK			= 0x0001,
 	MAPTILE_NO_SEE			= 0x0002,
 	MAPTILE_NO_SHOOT		= 0x0004,
-	MAPTILE_IS_VISIBLE		= 0x0008,
 	MAPTILE_IS_WALL			= 0x0010,
 	MAPTILE_IS_NOTHING		= 0x0020,
 	MAPTILE_IS_NORMAL_FLOOR	= 0x0040,
 	MAPTILE_IS_DRAINAGE		= 0x0080,
 	MAPTILE_OFFSET_PIC		= 0x0100,
-	MAPTILE_TILE_TRIGGER	= 0x0200,
-// These constants are used internally in draw, it is never set in the map
-	MAPTILE_DELAY_DRAW		= 0x0400,
-	MAPTILE_OUT_OF_SIGHT	= 0x0800
+	MAPTILE_TILE_TRIGGER	= 0x0200
 } MapTileFlags;
 
 #define KIND_CHARACTER      0
@@ -94,8 +93,9 @@ typedef enum
 #define OBJECTIVE_SHIFT         3
 
 
-typedef void (*TileItemDrawFunc) (int, int, void *);
+typedef void (*TileItemDrawFunc) (GraphicsDevice *, int, int, void *);
 
+struct TileItemCell;
 struct TileItem {
 	int x, y;
 	int w, h;
@@ -104,8 +104,9 @@ struct TileItem {
 	void *data;
 	TileItemDrawFunc drawFunc;
 	void *actor;
-	struct TileItem *next;
-	struct TileItem *nextToDisplay;
+	// Where the item is in the tile item index
+	struct TileItemCell *cell;
+	int slot;
 };
 typedef struct TileItem TTileItem;
 
@@ -115,14 +116,53 @@ typedef struct
 	Pic *pic;
 	Pic picAlt;
 	int flags;
-	int isVisited;
-	TTileItem *things;
 } Tile;
 
 extern Tile tileNone;
 extern Tile gMap[YMAX][XMAX];
 #define Map( x, y)  gMap[y][x]
 
+// One bit per tile, for a tile flag that collision or line of sight tests,
+// or for whether the tile has been seen
+// A whole map fits in a couple of KB, so these stay in cache where the
+// tiles themselves would not.
+// Tiles outside the map count as set.
+#define MAP_BITS_WORDS ((XMAX + 63) / 64)
+typedef struct
+{
+	uint64_t rows[YMAX][MAP_BITS_WORDS];
+} MapBits;
+
+// Tiles with MAPTILE_NO_WALK and MAPTILE_NO_SEE
+extern MapBits gMapNoWalk;
+extern MapBits gMapNoSee;
+// Tiles that players have seen
+extern MapBits gMapVisited;
+
+static INLINE int MapBitsGet(const MapBits *b, int x, int y)
+{
+	if (x < 0 || x >= XMAX || y < 0 || y >= YMAX)
+	{
+		return 1;
+	}
+	return (int)((b->rows[y][x >> 6] >> (x & 63)) & 1);
+}
+// Whether a tile has been seen; tiles outside the map never are
+static INLINE int MapIsVisited(int x, int y)
+{
+	return
+		x >= 0 && x < XMAX && y >= 0 && y < YMAX &&
+		MapBitsGet(&gMapVisited, x, y);
+}
+// Whether any tile in the inclusive rectangle is set
+int MapBitsAny(const MapBits *b, Vec2i min, Vec2i max);
+
+// Rebuild the bitboards from the tiles' flags
+void MapBitsInit(void);
+// Update the bitboards for a tile whose flags have changed
+// Returns the flags whose bits changed
+int MapBitsUpdateTile(Vec2i tile);
+
 int HasLockedRooms(void);
 int IsHighAccess(int x, int y);
 int MapAccessLevel(int x, int y);
@@ -231,5 +231,7 @@ MouseRect *MouseGetRectByTag(Mouse *mouse, int tag)
 
 void MouseDraw(Mouse *mouse)
 {
-	DrawTPic(mouse->currentPos.x, mouse->currentPos.y, mouse->cursor);
+	DrawTPic(
+		&gGraphicsDevice,
+		mouse->currentPos.x, mouse->currentPos.y, mouse->cursor);
 }
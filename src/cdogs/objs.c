@@ -67,6 +67,7 @@
 #include "gamedata.h"
 #include "mission.h"
 #include "game.h"
+#include "tile_item_index.h"
 #include "utils.h"
 
 #define SOUND_LOCK_MOBILE_OBJECT 12
@@ -83,79 +84,92 @@ int HitItem(TMobileObject * obj, int x, int y, special_damage_e special);
 
 // Draw functions
 
-void DrawObject(int x, int y, const TObject * obj)
+void DrawObject(
+	GraphicsDevice *device, int x, int y, const TObject * obj)
 {
 	const TOffsetPic *pic = obj->pic;
 
 	if (pic)
 	{
 		DrawTPic(
+			device,
 			x + pic->dx,
 			y + pic->dy,
 			PicManagerGetOldPic(&gPicManager, pic->picIndex));
 	}
 }
 
-void DrawBullet(int x, int y, const TMobileObject * obj)
+void DrawBullet(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cGeneralPics[OFSPIC_BULLET];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawBrownBullet(int x, int y, const TMobileObject * obj)
+void DrawBrownBullet(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cGeneralPics[OFSPIC_SNIPERBULLET];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawPetrifierBullet(int x, int y, const TMobileObject * obj)
+void DrawPetrifierBullet(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic = &cGeneralPics[OFSPIC_MOLOTOV];
 	DrawBTPic(
-		x + pic->dx, y + pic->dy - obj->z,
+		device, x + pic->dx, y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex),
 		&tintDarker);
 }
 
-void DrawSeeker(int x, int y, const TMobileObject * obj)
+void DrawSeeker(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cGeneralPics[OFSPIC_SNIPERBULLET];
 	DrawTTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex),
 		tableFlamed);
 }
 
-void DrawMine(int x, int y, const TMobileObject * obj)
+void DrawMine(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cGeneralPics[OFSPIC_MINE];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawDynamite(int x, int y, const TMobileObject * obj)
+void DrawDynamite(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cGeneralPics[OFSPIC_DYNAMITE];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
@@ -166,94 +180,107 @@ static void DrawGrenadeShadow(GraphicsDevice *device, Vec2i pos)
 	DrawShadow(device, pos, Vec2iNew(4, 3));
 }
 
-void DrawMolotov(int x, int y, const TMobileObject * obj)
+void DrawMolotov(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cGeneralPics[OFSPIC_MOLOTOV];
 	if (obj->z > 0)
 	{
-		DrawGrenadeShadow(&gGraphicsDevice, Vec2iNew(x, y));
+		DrawGrenadeShadow(device, Vec2iNew(x, y));
 		y -= obj->z / 16;
 	}
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawFlame(int x, int y, const TMobileObject * obj)
+void DrawFlame(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cFlamePics[obj->state & 3];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawLaserBolt(int x, int y, const TMobileObject * obj)
+void DrawLaserBolt(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cBeamPics[obj->state];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawBrightBolt(int x, int y, const TMobileObject * obj)
+void DrawBrightBolt(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cBrightBeamPics[obj->state];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawSpark(int x, int y, const TMobileObject * obj)
+void DrawSpark(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cGeneralPics[OFSPIC_SPARK];
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy - obj->z,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void DrawGrenade(int x, int y, const TMobileObject * obj)
+void DrawGrenade(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 	color_t grenadeColor = obj->bulletClass.GrenadeColor;
 	pic = &cGrenadePics[(obj->count / 2) & 3];
 	if (obj->z > 0)
 	{
-		DrawGrenadeShadow(&gGraphicsDevice, Vec2iNew(x, y));
+		DrawGrenadeShadow(device, Vec2iNew(x, y));
 		y -= obj->z / 16;
 	}
 	BlitMasked(
-		&gGraphicsDevice,
+		device,
 		PicManagerGetFromOld(&gPicManager, pic->picIndex),
 		Vec2iNew(x + pic->dx, y + pic->dy), grenadeColor, 1);
 }
 
-void DrawGasCloud(int x, int y, const TMobileObject * obj)
+void DrawGasCloud(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
 	pic = &cFireBallPics[8 + (obj->state & 3)];
 	DrawBTPic(
-		x + pic->dx, y + pic->dy,
+		device, x + pic->dx, y + pic->dy,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex),
 		obj->z ? &tintPurple : &tintPoison);
 }
 
-void DrawFireball(int x, int y, const TMobileObject * obj)
+void DrawFireball(
+	GraphicsDevice *device, int x, int y, const TMobileObject * obj)
 {
 	const TOffsetPic *pic;
 
@@ -265,13 +292,15 @@ void DrawFireball(int x, int y, const TMobileObject * obj)
 		y -= obj->z / 4;
 	}
 	DrawTPic(
+		device,
 		x + pic->dx,
 		y + pic->dy,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 }
 
-void BogusDraw(int x, int y, void *data)
+void BogusDraw(GraphicsDevice *device, int x, int y, void *data)
 {
+	UNUSED(device);
 	UNUSED(x);
 	UNUSED(y);
 	UNUSED(data);
@@ -298,6 +327,12 @@ static void TrackKills(int player, TActor *victim)
 	}
 }
 
+// Players can't hurt each other unless the damage hurts always
+static int CanHurtCharacter(int flags, int player, const TActor *actor)
+{
+	return (flags & FLAGS_HURTALWAYS) || player < 0 || !actor->pData;
+}
+
 // The damage function!
 
 int DamageCharacter(
@@ -313,7 +348,7 @@ int DamageCharacter(
 	TActor *actor = (TActor *)target->data;
 	int isInvulnerable;
 
-	if (!(flags & FLAGS_HURTALWAYS) && player >= 0 && actor->pData)
+	if (!CanHurtCharacter(flags, player, actor))
 	{
 		return 0;
 	}
@@ -492,6 +527,7 @@ static void DamageObject(
 		if (object->wreckedPic)
 		{
 			object->tileItem.flags = TILEITEM_IS_WRECK;
+			TileItemIndexUpdate(&object->tileItem);
 			object->pic = object->wreckedPic;
 		}
 		else
@@ -654,6 +690,7 @@ TMobileObject *AddMobileObject(TMobileObject **mobObjList, int player)
 	obj->next = *mobObjList;
 	obj->tileItem.drawFunc = (TileItemDrawFunc)BogusDraw;
 	obj->updateFunc = UpdateMobileObject;
+	obj->sweepIndex = -1;
 	*mobObjList = obj;
 	return obj;
 }
@@ -868,22 +905,19 @@ int UpdateSpark(TMobileObject *obj, int ticks)
 	return 1;
 }
 
-int HitItem(TMobileObject * obj, int x, int y, special_damage_e special)
+// Don't hit if no damage dealt
+// This covers non-damaging debris explosions
+static int CanDamage(const TMobileObject *obj, special_damage_e special)
 {
-	TTileItem *item;
-	int hasHit;
-	Vec2i realPos = Vec2iScaleDiv(Vec2iNew(x, y), 256);
-
-	// Don't hit if no damage dealt
-	// This covers non-damaging debris explosions
-	if (obj->power <= 0 && (special == SPECIAL_NONE || special == SPECIAL_EXPLOSION))
-	{
-		return 0;
-	}
+	return
+		obj->power > 0 ||
+		(special != SPECIAL_NONE && special != SPECIAL_EXPLOSION);
+}
 
-	item = GetItemOnTileInCollision(
-		&obj->tileItem, realPos, TILEITEM_CAN_BE_SHOT, COLLISIONTEAM_NONE);
-	hasHit = DamageSomething(
+static int DamageTileItem(
+	TMobileObject *obj, TTileItem *item, special_damage_e special)
+{
+	int hasHit = DamageSomething(
 		Vec2iNew(obj->dx, obj->dy),
 		obj->power,
 		obj->flags,
@@ -898,36 +932,75 @@ int HitItem(TMobileObject * obj, int x, int y, special_damage_e special)
 	return hasHit;
 }
 
+int HitItem(TMobileObject * obj, int x, int y, special_damage_e special)
+{
+	TTileItem *item;
+	Vec2i realPos = Vec2iScaleDiv(Vec2iNew(x, y), 256);
+
+	if (!CanDamage(obj, special))
+	{
+		return 0;
+	}
+
+	item = CollisionBatchGetItem(
+		obj->sweepIndex,
+		&obj->tileItem, realPos, TILEITEM_CAN_BE_SHOT, COLLISIONTEAM_NONE);
+	return DamageTileItem(obj, item, special);
+}
+
+// Items that DamageSomething would not damage are passed through
+static int CanMobileObjectHit(const TTileItem *target, void *data)
+{
+	const TMobileObject *obj = data;
+	return
+		target->kind != KIND_CHARACTER ||
+		CanHurtCharacter(obj->flags, obj->player, target->data);
+}
+
+// Sweep the object over its move for the ticks, for the first wall or item
+// it hits
+static CollisionSweep SweepMobileObject(
+	TMobileObject *obj, int ticks, special_damage_e special)
+{
+	return CollisionBatchSweep(
+		obj->sweepIndex,
+		&obj->tileItem,
+		Vec2iNew(obj->x, obj->y),
+		Vec2iNew(obj->x + obj->dx * ticks, obj->y + obj->dy * ticks),
+		CanDamage(obj, special) ? TILEITEM_CAN_BE_SHOT : 0,
+		COLLISIONTEAM_NONE,
+		CanMobileObjectHit, obj);
+}
+
+static void MoveMobileObject(TMobileObject *obj, Vec2i pos)
+{
+	obj->x = pos.x;
+	obj->y = pos.y;
+	MoveTileItem(&obj->tileItem, pos.x >> 8, pos.y >> 8);
+}
+
 int InternalUpdateBullet(TMobileObject *obj, int special, int ticks)
 {
-	int x, y;
+	CollisionSweep hit;
 
 	MobileObjectUpdate(obj, ticks);
 	if (obj->count > obj->range)
 		return 0;
 
-	x = obj->x + obj->dx * ticks;
-	y = obj->y + obj->dy * ticks;
-
-	if (HitItem(obj, x, y, special)) {
-		obj->count = 0;
-		obj->range = 0;
-		obj->tileItem.drawFunc = (TileItemDrawFunc)DrawSpark;
-		obj->updateFunc = UpdateSpark;
-		return 1;
+	hit = SweepMobileObject(obj, ticks, special);
+	MoveMobileObject(obj, hit.pos);
+	if (hit.item != NULL)
+	{
+		DamageTileItem(obj, hit.item, special);
 	}
-	if (!HitWall(x >> 8, y >> 8)) {
-		obj->x = x;
-		obj->y = y;
-		MoveTileItem(&obj->tileItem, x >> 8, y >> 8);
-		return 1;
-	} else {
+	if (hit.item != NULL || hit.isWall)
+	{
 		obj->count = 0;
 		obj->range = 0;
 		obj->tileItem.drawFunc = (TileItemDrawFunc)DrawSpark;
 		obj->updateFunc = UpdateSpark;
-		return 1;
 	}
+	return 1;
 }
 
 int UpdateBullet(TMobileObject *obj, int ticks)
@@ -1024,10 +1097,11 @@ int UpdateActiveMine(TMobileObject *obj, int ticks)
 	{
 		for (dx = -1; dx <= 1; dx++)
 		{
-			TTileItem *item = Map(tx + dx, ty + dy).things;
-			while (item)
+			const TileItemCell *cell = TileItemIndexGetCell(tx + dx, ty + dy);
+			int i;
+			for (i = 0; i < cell->count; i++)
 			{
-				if (item->kind == KIND_CHARACTER)
+				if (cell->entries[i].kind == KIND_CHARACTER)
 				{
 					obj->updateFunc = UpdateTriggeredMine;
 					obj->count = 0;
@@ -1038,7 +1112,6 @@ int UpdateActiveMine(TMobileObject *obj, int ticks)
 						Vec2iNew(obj->tileItem.x, obj->tileItem.y));
 					return 1;
 				}
-				item = item->next;
 			}
 		}
 	}
@@ -1055,7 +1128,7 @@ int UpdateDroppedMine(TMobileObject *obj, int ticks)
 
 int UpdateFlame(TMobileObject *obj, int ticks)
 {
-	int x, y;
+	CollisionSweep hit;
 
 	MobileObjectUpdate(obj, ticks);
 	if (obj->count > obj->range)
@@ -1064,21 +1137,18 @@ int UpdateFlame(TMobileObject *obj, int ticks)
 	if ((obj->count & 3) == 0)
 		obj->state = rand();
 
-	x = obj->x + obj->dx * ticks;
-	y = obj->y + obj->dy * ticks;
-
-	if (HitItem(obj, x, y, SPECIAL_FLAME)) {
+	hit = SweepMobileObject(obj, ticks, SPECIAL_FLAME);
+	if (hit.item != NULL)
+	{
+		DamageTileItem(obj, hit.item, SPECIAL_FLAME);
 		obj->count = obj->range;
-		obj->x = x;
-		obj->y = y;
-		MoveTileItem(&obj->tileItem, x >> 8, y >> 8);
+		MoveMobileObject(obj, hit.pos);
 		return 1;
 	}
 
-	if (!HitWall(x >> 8, y >> 8)) {
-		obj->x = x;
-		obj->y = y;
-		MoveTileItem(&obj->tileItem, x >> 8, y >> 8);
+	if (!hit.isWall)
+	{
+		MoveMobileObject(obj, hit.pos);
 		return 1;
 	} else
 		return 0;
@@ -1086,7 +1156,8 @@ int UpdateFlame(TMobileObject *obj, int ticks)
 
 int UpdateExplosion(TMobileObject *obj, int ticks)
 {
-	int x, y;
+	Vec2i to;
+	CollisionSweep hit;
 
 	MobileObjectUpdate(obj, ticks);
 	if (obj->count < 0)
@@ -1094,27 +1165,66 @@ int UpdateExplosion(TMobileObject *obj, int ticks)
 	if (obj->count > obj->range)
 		return 0;
 
-	x = obj->x + obj->dx * ticks;
-	y = obj->y + obj->dy * ticks;
+	to = Vec2iNew(obj->x + obj->dx * ticks, obj->y + obj->dy * ticks);
+	hit = SweepMobileObject(obj, ticks, SPECIAL_EXPLOSION);
 	obj->z += obj->dz * ticks;
 	obj->dz = MAX(0, obj->dz - ticks);
 
-	HitItem(obj, x, y, SPECIAL_EXPLOSION);
+	if (hit.item != NULL)
+	{
+		DamageTileItem(obj, hit.item, SPECIAL_EXPLOSION);
+		// Explosions carry on through what they hit, up to a wall
+		hit = SweepForCollision(
+			&obj->tileItem, hit.pos, to, 0, COLLISIONTEAM_NONE, NULL, NULL);
+	}
 
-	if (!HitWall(x >> 8, y >> 8)) {
-		obj->x = x;
-		obj->y = y;
-		MoveTileItem(&obj->tileItem, x >> 8, y >> 8);
+	if (!hit.isWall)
+	{
+		MoveMobileObject(obj, hit.pos);
 		return 1;
 	}
 	return 0;
 }
 
+// Whether the object's update tests for items to hit, over its move
+static int IsHittingUpdate(BulletUpdateFunc f)
+{
+	return
+		f == UpdateBullet ||
+		f == UpdatePetrifierBullet ||
+		f == UpdateSeeker ||
+		f == UpdateBrownBullet ||
+		f == UpdateFlame ||
+		f == UpdateExplosion ||
+		f == UpdateMolotovFlame ||
+		f == UpdateGasCloud;
+}
+
 void UpdateMobileObjects(TMobileObject **mobObjList, int ticks)
 {
-	TMobileObject *obj = *mobObjList;
+	TMobileObject *obj;
 	int do_remove = 0;
 
+	// Find what all the objects could hit over their moves at once, so
+	// that objects close together, like a grenade's frags or an
+	// explosion's fireballs, don't each scan the same tiles.
+	// Objects then hit things in list order, as they are updated.
+	CollisionBatchBegin();
+	for (obj = *mobObjList; obj; obj = obj->next)
+	{
+		obj->sweepIndex = -1;
+		if (IsHittingUpdate(obj->updateFunc))
+		{
+			obj->sweepIndex = CollisionBatchAdd(
+				&obj->tileItem,
+				Vec2iNew(obj->x, obj->y),
+				Vec2iNew(obj->x + obj->dx * ticks, obj->y + obj->dy * ticks),
+				TILEITEM_CAN_BE_SHOT);
+		}
+	}
+	CollisionBatchFindCandidates();
+
+	obj = *mobObjList;
 	while (obj)
 	{
 		if ((*(obj->updateFunc))(obj, ticks) == 0)
@@ -1124,6 +1234,7 @@ void UpdateMobileObjects(TMobileObject **mobObjList, int ticks)
 		}
 		obj = obj->next;
 	}
+	CollisionBatchEnd();
 	if (do_remove)
 	{
 		while (*mobObjList)
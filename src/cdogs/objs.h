@@ -182,6 +182,8 @@ struct MobileObject
 	int soundLock;
 	TTileItem tileItem;
 	BulletUpdateFunc updateFunc;
+	// This tick's sweep in the collision batch, or -1
+	int sweepIndex;
 	struct MobileObject *next;
 };
 typedef int (*MobObjUpdateFunc)(struct MobileObject *, int);
@@ -0,0 +1,128 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "overdraw.h"
+
+#include <string.h>
+
+#include <SDL.h>
+
+#include "utils.h"
+
+// Blits only ever write pixels without the top byte set, see
+// PixelFromColor, so this marks pixels no command has written
+#define OVERDRAW_UNWRITTEN 0xFF000000
+
+void OverdrawInit(Overdraw *o, Vec2i size)
+{
+	memset(o, 0, sizeof *o);
+	o->size = size;
+	CCALLOC(o->counts, size.x * size.y * sizeof *o->counts);
+	CMALLOC(o->scratch, size.x * size.y * sizeof *o->scratch);
+}
+void OverdrawTerminate(Overdraw *o)
+{
+	CFREE(o->counts);
+	CFREE(o->scratch);
+}
+
+void OverdrawAdd(Overdraw *o, const DrawContext *c)
+{
+	const DrawCommandList *l = &c->commandList;
+	GraphicsDevice device = c->device;
+	int i;
+	device.buf = o->scratch;
+	for (i = 0; i < l->count; i++)
+	{
+		const DrawCommand *cmd = &l->commands[i];
+		const BlitClipping *r = &cmd->bounds;
+		int x, y;
+		// The bounds are within the device, which is no bigger than the
+		// scratch framebuffer
+		for (y = r->top; y <= r->bottom; y++)
+		{
+			for (x = r->left; x <= r->right; x++)
+			{
+				o->scratch[y * o->size.x + x] = OVERDRAW_UNWRITTEN;
+			}
+		}
+		device.clipping = *r;
+		DrawCommandRun(cmd, &device);
+		for (y = r->top; y <= r->bottom; y++)
+		{
+			for (x = r->left; x <= r->right; x++)
+			{
+				const int idx = y * o->size.x + x;
+				if (o->scratch[idx] == OVERDRAW_UNWRITTEN)
+				{
+					continue;
+				}
+				if (o->counts[idx] == 0)
+				{
+					o->pixelsWritten++;
+				}
+				if (o->counts[idx] < 255)
+				{
+					o->counts[idx]++;
+				}
+				o->writes++;
+			}
+		}
+	}
+}
+
+int OverdrawSave(const Overdraw *o, const char *filename)
+{
+	static const Uint32 colors[] =
+	{
+		0x000000, 0x0000FF, 0x00FF00, 0xFFFF00, 0xFF0000
+	};
+	const int colorCount = sizeof colors / sizeof colors[0];
+	SDL_Surface *s = SDL_CreateRGBSurface(
+		SDL_SWSURFACE, o->size.x, o->size.y, 32,
+		0xFF0000, 0x00FF00, 0x0000FF, 0);
+	int x, y;
+	int result;
+	if (s == NULL)
+	{
+		return 0;
+	}
+	SDL_LockSurface(s);
+	for (y = 0; y < o->size.y; y++)
+	{
+		Uint32 *row = (Uint32 *)((Uint8 *)s->pixels + y * s->pitch);
+		for (x = 0; x < o->size.x; x++)
+		{
+			row[x] = colors[MIN(o->counts[y * o->size.x + x], colorCount - 1)];
+		}
+	}
+	SDL_UnlockSurface(s);
+	result = SDL_SaveBMP(s, filename) == 0;
+	SDL_FreeSurface(s);
+	return result;
+}
@@ -0,0 +1,58 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __OVERDRAW
+#define __OVERDRAW
+
+#include "draw.h"
+
+// Overdraw accounting, for debugging: how many times each framebuffer pixel
+// is written while drawing the game view.
+// Counted exactly from the viewports' recorded draw commands, by replaying
+// each one into a scratch framebuffer and seeing which pixels it changed.
+
+typedef struct
+{
+	Vec2i size;
+	// Writes per framebuffer pixel, saturating
+	Uint8 *counts;
+	Uint32 *scratch;
+	int pixelsWritten;
+	int writes;
+} Overdraw;
+
+void OverdrawInit(Overdraw *o, Vec2i size);
+void OverdrawTerminate(Overdraw *o);
+// Count the writes of the commands recorded by DrawBufferRecord
+void OverdrawAdd(Overdraw *o, const DrawContext *c);
+// Save the counts as a heatmap bitmap: black for unwritten pixels, then
+// blue, green, yellow and red for 1, 2, 3, and 4 or more writes
+// Returns 0 on failure
+int OverdrawSave(const Overdraw *o, const char *filename);
+
+#endif
@@ -27,10 +27,50 @@
 */
 #include "palette.h"
 
+#include <SDL_mutex.h>
+
 #include "blit.h"
 #include "utils.h"
 
 static TPalette gCurrentPalette;
+
+// Palette colours converted to pixels, so that blits only need
+// one table load per pixel
+// Rebuilt as soon as the palette changes, so reading it never writes
+static Uint32 gPaletteLUT[256];
+
+// Translation tables fused with the palette LUT, i.e. for each table,
+// lut[i] = LookupPalette(table[i])
+// Entries are chained in buckets keyed by the table's address. They are
+// never moved or evicted, so a LUT can be drawn with while other threads
+// look up theirs; stale ones are rebuilt in place, which is safe since the
+// palette and tables only change between frames.
+#define TRANSLATION_LUT_BUCKETS 64
+typedef struct TranslationLUT
+{
+	const TranslationTable *table;
+	int generation;
+	Uint32 lut[256];
+	struct TranslationLUT *next;
+} TranslationLUT;
+static TranslationLUT *gTranslationLUTs[TRANSLATION_LUT_BUCKETS];
+static SDL_mutex *gTranslationLUTLock = NULL;
+
+// Tint LUTs, chained in buckets keyed by the tint's value, the same way
+// There are only a few tints, and they don't depend on the palette, so
+// entries are built once and kept
+#define TINT_LUT_BUCKETS 16
+typedef struct TintLUTEntry
+{
+	HSV tint;
+	TintLUT lut;
+	struct TintLUTEntry *next;
+} TintLUTEntry;
+static TintLUTEntry *gTintLUTs[TINT_LUT_BUCKETS];
+static SDL_mutex *gTintLUTLock = NULL;
+// Starts at 1 so new entries are always built
+static int gLUTGeneration = 1;
+
 #define GAMMA 4
 color_t PaletteToColor(unsigned char index)
 {
@@ -41,12 +81,141 @@ color_t PaletteToColor(unsigned char index)
 	color.a = 255;
 	return color;
 }
+
+const Uint32 *PaletteGetLUT(void)
+{
+	return gPaletteLUT;
+}
 Uint32 LookupPalette(unsigned char index)
 {
-	return PixelFromColor(&gGraphicsDevice, PaletteToColor(index));
+	return PaletteGetLUT()[index];
+}
+
+static int TranslationLUTIndex(const TranslationTable *table)
+{
+	// Tables are at least 256 bytes apart, so drop the low bits
+	size_t h = (size_t)table >> 8;
+	h ^= h >> 6;
+	return (int)(h % TRANSLATION_LUT_BUCKETS);
+}
+const Uint32 *PaletteGetTranslationLUT(const TranslationTable *table)
+{
+	TranslationLUT **bucket = &gTranslationLUTs[TranslationLUTIndex(table)];
+	TranslationLUT *entry;
+	SDL_LockMutex(gTranslationLUTLock);
+	for (entry = *bucket; entry != NULL; entry = entry->next)
+	{
+		if (entry->table == table)
+		{
+			break;
+		}
+	}
+	if (entry == NULL)
+	{
+		CCALLOC(entry, sizeof *entry);
+		entry->table = table;
+		entry->next = *bucket;
+		*bucket = entry;
+	}
+	if (entry->generation != gLUTGeneration)
+	{
+		int i;
+		for (i = 0; i < 256; i++)
+		{
+			entry->lut[i] = gPaletteLUT[(*table)[i]];
+		}
+		entry->generation = gLUTGeneration;
+	}
+	SDL_UnlockMutex(gTranslationLUTLock);
+	return entry->lut;
+}
+
+static int TintLUTIndex(const HSV *tint)
+{
+	// FNV-1a over the tint's bytes
+	const unsigned char *bytes = (const unsigned char *)tint;
+	unsigned int h = 2166136261u;
+	size_t i;
+	for (i = 0; i < sizeof *tint; i++)
+	{
+		h = (h ^ bytes[i]) * 16777619u;
+	}
+	return (int)(h % TINT_LUT_BUCKETS);
+}
+const TintLUT *PaletteGetTintLUT(const HSV *tint)
+{
+	TintLUTEntry **bucket = &gTintLUTs[TintLUTIndex(tint)];
+	TintLUTEntry *entry;
+	SDL_LockMutex(gTintLUTLock);
+	for (entry = *bucket; entry != NULL; entry = entry->next)
+	{
+		if (entry->tint.h == tint->h &&
+			entry->tint.s == tint->s &&
+			entry->tint.v == tint->v)
+		{
+			break;
+		}
+	}
+	if (entry == NULL)
+	{
+		CMALLOC(entry, sizeof *entry);
+		entry->tint = *tint;
+		TintLUTInit(&entry->lut, *tint);
+		entry->next = *bucket;
+		*bucket = entry;
+	}
+	SDL_UnlockMutex(gTintLUTLock);
+	return &entry->lut;
+}
+
+void PaletteInvalidateLUTs(void)
+{
+	int i;
+	for (i = 0; i < 256; i++)
+	{
+		gPaletteLUT[i] = PixelFromColor(PaletteToColor((unsigned char)i));
+	}
+	gLUTGeneration++;
+}
+int PaletteGetLUTGeneration(void)
+{
+	return gLUTGeneration;
+}
+
+void PaletteInit(void)
+{
+	gTranslationLUTLock = SDL_CreateMutex();
+	gTintLUTLock = SDL_CreateMutex();
+}
+void PaletteTerminate(void)
+{
+	int i;
+	for (i = 0; i < TRANSLATION_LUT_BUCKETS; i++)
+	{
+		while (gTranslationLUTs[i] != NULL)
+		{
+			TranslationLUT *next = gTranslationLUTs[i]->next;
+			CFREE(gTranslationLUTs[i]);
+			gTranslationLUTs[i] = next;
+		}
+	}
+	for (i = 0; i < TINT_LUT_BUCKETS; i++)
+	{
+		while (gTintLUTs[i] != NULL)
+		{
+			TintLUTEntry *next = gTintLUTs[i]->next;
+			CFREE(gTintLUTs[i]);
+			gTintLUTs[i] = next;
+		}
+	}
+	SDL_DestroyMutex(gTranslationLUTLock);
+	gTranslationLUTLock = NULL;
+	SDL_DestroyMutex(gTintLUTLock);
+	gTintLUTLock = NULL;
 }
 
 void CDogsSetPalette(TPalette palette)
 {
 	memcpy(gCurrentPalette, palette, sizeof gCurrentPalette);
+	PaletteInvalidateLUTs();
 }
@@ -33,7 +33,22 @@
 #include "pic_file.h"
 
 color_t PaletteToColor(unsigned char index);
+// Palette colours as framebuffer pixels, indexed by palette index
+const Uint32 *PaletteGetLUT(void);
 Uint32 LookupPalette(unsigned char index);
+// Translation table fused with the palette: lut[i] = LookupPalette(table[i])
+// The result is cached until the palette or any table changes
+// Safe to call from several threads while drawing
+const Uint32 *PaletteGetTranslationLUT(const TranslationTable *table);
+// Tables of the tint's results for all pixels; kept for the tint's value
+// Safe to call from several threads while drawing
+const TintLUT *PaletteGetTintLUT(const HSV *tint);
+// Call whenever the palette or a translation table changes
+void PaletteInvalidateLUTs(void);
+// Incremented by each invalidation, for caches of already translated pixels
+int PaletteGetLUTGeneration(void);
+void PaletteInit(void);
+void PaletteTerminate(void);
 void CDogsSetPalette(TPalette palette);
 
 #endif
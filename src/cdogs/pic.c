@@ -27,16 +27,18 @@
 */
 #include "pic.h"
 
+#include "blit_simd.h"
 #include "palette.h"
 #include "utils.h"
 
-Pic picNone = { { 0, 0 }, { 0, 0 }, NULL };
+Pic picNone = { { 0, 0 }, { 0, 0 }, NULL, NULL };
 
 void PicFromPicPaletted(Pic *pic, PicPaletted *picP)
 {
 	int i;
 	pic->size = Vec2iNew(picP->w, picP->h);
 	pic->offset = Vec2iZero();
+	pic->rle = NULL;
 	CMALLOC(pic->data, pic->size.x * pic->size.y * sizeof *pic->data);
 	for (i = 0; i < pic->size.x * pic->size.y; i++)
 	{
@@ -53,9 +55,81 @@ void PicFromPicPalettedOffset(
 void PicFree(Pic *pic)
 {
 	CFREE(pic->data);
+	PicRLEFree(pic->rle);
+	pic->rle = NULL;
 }
 
 int PicIsNotNone(Pic *pic)
 {
 	return pic->size.x > 0 && pic->size.y > 0 && pic->data != NULL;
 }
+
+PicRLE *PicRLEFromMask(const unsigned char *isOpaque, int w, int h)
+{
+	PicRLE *rle;
+	int runCount = 0;
+	int i;
+	int y;
+	// Count runs first so the runs can be stored contiguously
+	for (i = 0; i < w * h; i++)
+	{
+		if (isOpaque[i] && (i % w == 0 || !isOpaque[i - 1]))
+		{
+			runCount++;
+		}
+	}
+	CMALLOC(rle, sizeof *rle);
+	CMALLOC(rle->rowStarts, (h + 1) * sizeof *rle->rowStarts);
+	CMALLOC(rle->runs, MAX(runCount, 1) * sizeof *rle->runs);
+	runCount = 0;
+	for (y = 0; y < h; y++)
+	{
+		const unsigned char *row = isOpaque + y * w;
+		int x = 0;
+		rle->rowStarts[y] = runCount;
+		while (x < w)
+		{
+			PicRun *run;
+			if (!row[x])
+			{
+				x++;
+				continue;
+			}
+			run = &rle->runs[runCount++];
+			run->x = (uint16_t)x;
+			while (x < w && row[x])
+			{
+				x++;
+			}
+			run->len = (uint16_t)(x - run->x);
+		}
+	}
+	rle->rowStarts[h] = runCount;
+	return rle;
+}
+
+void PicPalettedCompileRLE(PicPaletted *pic)
+{
+	PicRLEFree(pic->rle);
+	pic->rle = PicRLEFromMask(pic->data, pic->w, pic->h);
+}
+void PicCompileRLE(Pic *pic)
+{
+	unsigned char *isOpaque;
+	PicRLEFree(pic->rle);
+	CMALLOC(isOpaque, pic->size.x * pic->size.y);
+	gBlitRowKernels.OpaqueMaskRow(
+		isOpaque, pic->data, pic->size.x * pic->size.y);
+	pic->rle = PicRLEFromMask(isOpaque, pic->size.x, pic->size.y);
+	CFREE(isOpaque);
+}
+void PicRLEFree(PicRLE *rle)
+{
+	if (rle == NULL)
+	{
+		return;
+	}
+	CFREE(rle->rowStarts);
+	CFREE(rle->runs);
+	CFREE(rle);
+}
@@ -36,6 +36,8 @@ typedef struct
 	Vec2i size;
 	Vec2i offset;
 	color_t *data;
+	// Compiled opaque (non-black) runs; NULL if not compiled
+	PicRLE *rle;
 } Pic;
 
 extern Pic picNone;
@@ -46,4 +48,12 @@ void PicFromPicPalettedOffset(
 void PicFree(Pic *pic);
 int PicIsNotNone(Pic *pic);
 
+// Compile the RLE opaque runs used by transparent blits
+// Paletted pics are transparent at index 0, pics where they are black
+void PicPalettedCompileRLE(PicPaletted *pic);
+void PicCompileRLE(Pic *pic);
+// Encode a w x h opacity mask as runs
+PicRLE *PicRLEFromMask(const unsigned char *isOpaque, int w, int h);
+void PicRLEFree(PicRLE *rle);
+
 #endif
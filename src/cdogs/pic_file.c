@@ -48,6 +48,7 @@
 */
 #include "pic_file.h"
 
+#include <stddef.h>
 #include <stdio.h>
 
 #include "files.h"
@@ -97,12 +98,16 @@ int ReadPics(const char *filename, PicPaletted **pics, int maxPics, TPalette pal
 			if (size > 0)
 			{
 				PicPaletted *p;
-				CMALLOC(p, size);
+				CMALLOC(
+					p,
+					offsetof(PicPaletted, data) +
+					size - PIC_PALETTED_HEADER_SIZE);
+				p->rle = NULL;
 
 				f_read16(f, &p->w, 2);
 				f_read16(f, &p->h, 2);
 
-				f_read(f, &p->data, size - 4);
+				f_read(f, &p->data, size - PIC_PALETTED_HEADER_SIZE);
 
 				pics[i] = p;
 
@@ -150,11 +155,15 @@ int AppendPics(const char *filename, PicPaletted **pics, int startIndex, int max
 			if (size > 0)
 			{
 				PicPaletted *p;
-				CMALLOC(p, size);
+				CMALLOC(
+					p,
+					offsetof(PicPaletted, data) +
+					size - PIC_PALETTED_HEADER_SIZE);
+				p->rle = NULL;
 
 				f_read16(f, &p->w, 2);
 				f_read16(f, &p->h, 2);
-				f_read(f, &p->data, size - 4);
+				f_read(f, &p->data, size - PIC_PALETTED_HEADER_SIZE);
 
 				pics[i] = p;
 
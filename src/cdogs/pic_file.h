@@ -56,12 +56,31 @@
 
 typedef color_t TPalette[256];
 typedef unsigned char TranslationTable[256];
+
+// Run-length encoded transparency for sprites
+// Each row is stored as a list of opaque runs, in increasing x order;
+// everything between runs is transparent and can be skipped entirely
+typedef struct
+{
+	uint16_t x;
+	uint16_t len;
+} PicRun;
+typedef struct
+{
+	// Runs for row y are runs[rowStarts[y]] to runs[rowStarts[y + 1] - 1]
+	int *rowStarts;
+	PicRun *runs;
+} PicRLE;
+
 typedef struct
 {
 	uint16_t w;
 	uint16_t h;
+	// Compiled opaque runs; NULL if not compiled
+	PicRLE *rle;
 	unsigned char data[1];
 } PicPaletted;
+#define PIC_PALETTED_HEADER_SIZE 4
 
 typedef struct
 {
@@ -50,6 +50,14 @@ int PicManagerTryInit(
 		return 0;
 	}
 	pm->palette[0].r = pm->palette[0].g = pm->palette[0].b = 0;
+	// Compile sprites for fast transparent blits
+	for (i = 0; i < PIC_MAX; i++)
+	{
+		if (pm->oldPics[i] != NULL)
+		{
+			PicPalettedCompileRLE(pm->oldPics[i]);
+		}
+	}
 	return 1;
 }
 
@@ -72,6 +80,7 @@ void PicManagerGenerateOldPics(PicManager *pm)
 		else
 		{
 			PicFromPicPaletted(&pm->picsFromOld[i], oldPic);
+			PicCompileRLE(&pm->picsFromOld[i]);
 		}
 	}
 }
@@ -83,6 +92,7 @@ void PicManagerTerminate(PicManager *pm)
 	{
 		if (pm->oldPics[i] != NULL)
 		{
+			PicRLEFree(pm->oldPics[i]->rle);
 			CFREE(pm->oldPics[i]);
 		}
 		if (PicIsNotNone(&pm->picsFromOld[i]))
@@ -57,6 +57,9 @@
 #include "config.h"
 #include "grafx.h"
 #include "blit.h"
+#include "palette.h"
+#include "pic.h"
+#include "utils.h"
 #include "actors.h" /* for tableFlamed */
 
 #define FIRST_CHAR      0
@@ -72,6 +75,25 @@ static int yCDogsText = 0;
 static int hCDogsText = 0;
 static PicPaletted *gFont[CHARS_IN_FONT];
 
+// The font converted to colours, all glyphs packed in one allocation, with
+// each glyph's opaque runs compiled
+// The conversion depends on the palette so it is redone when that changes
+static color_t *gFontAtlas = NULL;
+static Pic gFontPics[CHARS_IN_FONT];
+static int gFontAtlasGeneration = 0;
+
+// Direct-mapped cache of measured strings, keyed by their contents
+// Longer strings are measured every time
+#define TEXT_SIZE_CACHE_COUNT 256
+#define TEXT_SIZE_CACHE_STRLEN 64
+typedef struct
+{
+	char s[TEXT_SIZE_CACHE_STRLEN];
+	int width;
+	Vec2i size;
+} TextSizeEntry;
+static TextSizeEntry gTextSizeCache[TEXT_SIZE_CACHE_COUNT];
+
 
 void CDogsTextInit(const char *filename, int offset)
 {
@@ -80,12 +102,22 @@ void CDogsTextInit(const char *filename, int offset)
 	dxCDogsText = offset;
 	memset(gFont, 0, sizeof(gFont));
 	ReadPics(filename, gFont, CHARS_IN_FONT, NULL);
+	memset(gTextSizeCache, 0, sizeof gTextSizeCache);
+	for (i = 0; i < CHARS_IN_FONT; i++)
+	{
+		PicRLEFree(gFontPics[i].rle);
+	}
+	memset(gFontPics, 0, sizeof gFontPics);
+	CFREE(gFontAtlas);
+	gFontAtlas = NULL;
+	gFontAtlasGeneration = 0;
 
 	for (i = 0; i < CHARS_IN_FONT; i++)
 	{
 		if (gFont[i] != NULL)
 		{
 			hCDogsText = MAX(hCDogsText, gFont[i]->h);
+			PicPalettedCompileRLE(gFont[i]);
 		}
 	}
 }
@@ -95,13 +127,13 @@ void CDogsTextChar(char c)
 	int i = CHAR_INDEX(c);
 	if (i >= 0 && i <= CHARS_IN_FONT && gFont[i])
 	{
-		DrawTPic(xCDogsText, yCDogsText, gFont[i]);
+		DrawTPic(&gGraphicsDevice, xCDogsText, yCDogsText, gFont[i]);
 		xCDogsText += 1 + gFont[i]->w + dxCDogsText;
 	}
 	else
 	{
 		i = CHAR_INDEX('.');
-		DrawTPic(xCDogsText, yCDogsText, gFont[i]);
+		DrawTPic(&gGraphicsDevice, xCDogsText, yCDogsText, gFont[i]);
 		xCDogsText += 1 + gFont[i]->w + dxCDogsText;
 	}
 }
@@ -111,13 +143,13 @@ void CDogsTextCharWithTable(char c, TranslationTable * table)
 	int i = CHAR_INDEX(c);
 	if (i >= 0 && i <= CHARS_IN_FONT && gFont[i])
 	{
-		DrawTTPic(xCDogsText, yCDogsText, gFont[i], table);
+		DrawTTPic(&gGraphicsDevice, xCDogsText, yCDogsText, gFont[i], table);
 		xCDogsText += 1 + gFont[i]->w + dxCDogsText;
 	}
 	else
 	{
 		i = CHAR_INDEX('.');
-		DrawTTPic(xCDogsText, yCDogsText, gFont[i], table);
+		DrawTTPic(&gGraphicsDevice, xCDogsText, yCDogsText, gFont[i], table);
 		xCDogsText += 1 + gFont[i]->w + dxCDogsText;
 	}
 }
@@ -134,7 +166,7 @@ void CDogsTextStringWithTable(const char *s, TranslationTable * table)
 		CDogsTextCharWithTable(*s++, table);
 }
 
-static PicPaletted *GetgFontPic(char c)
+static int GetFontIndex(char c)
 {
 	int i = CHAR_INDEX(c);
 	if (i < 0 || i > CHARS_IN_FONT || !gFont[i])
@@ -142,19 +174,60 @@ static PicPaletted *GetgFontPic(char c)
 		i = CHAR_INDEX('.');
 	}
 	assert(gFont[i]);
-	return gFont[i];
+	return i;
+}
+
+static void FontAtlasUpdate(void)
+{
+	int i;
+	color_t *data;
+	if (gFontAtlasGeneration == PaletteGetLUTGeneration())
+	{
+		return;
+	}
+	if (gFontAtlas == NULL)
+	{
+		int size = 0;
+		for (i = 0; i < CHARS_IN_FONT; i++)
+		{
+			if (gFont[i] != NULL)
+			{
+				size += gFont[i]->w * gFont[i]->h;
+			}
+		}
+		CMALLOC(gFontAtlas, MAX(size, 1) * sizeof *gFontAtlas);
+	}
+	data = gFontAtlas;
+	for (i = 0; i < CHARS_IN_FONT; i++)
+	{
+		const PicPaletted *font = gFont[i];
+		Pic *pic = &gFontPics[i];
+		int j;
+		if (font == NULL)
+		{
+			continue;
+		}
+		pic->size = Vec2iNew(font->w, font->h);
+		pic->offset = Vec2iZero();
+		pic->data = data;
+		for (j = 0; j < font->w * font->h; j++)
+		{
+			data[j] = PaletteToColor(font->data[j]);
+		}
+		PicCompileRLE(pic);
+		data += font->w * font->h;
+	}
+	gFontAtlasGeneration = PaletteGetLUTGeneration();
 }
 
 Vec2i DrawTextCharMasked(
 	char c, GraphicsDevice *device, Vec2i pos, color_t mask)
 {
-	PicPaletted *font = GetgFontPic(c);
-	Pic pic;
-	PicFromPicPaletted(&pic, font);
-	BlitMasked(device, &pic, pos, mask, 1);
-	pos.x += 1 + font->w + dxCDogsText;
+	const int i = GetFontIndex(c);
+	FontAtlasUpdate();
+	BlitRLEMasked(device, &gFontPics[i], pos, mask);
+	pos.x += 1 + gFont[i]->w + dxCDogsText;
 	CDogsTextGoto(pos.x, pos.y);
-	PicFree(&pic);
 	return pos;
 }
 
@@ -183,7 +256,7 @@ Vec2i DrawTextString(const char *s, GraphicsDevice *device, Vec2i pos)
 	return DrawTextStringMasked(s, device, pos, colorWhite);
 }
 
-Vec2i TextGetSize(const char *s)
+static Vec2i MeasureSize(const char *s)
 {
 	Vec2i size = Vec2iZero();
 	while (*s)
@@ -197,13 +270,47 @@ Vec2i TextGetSize(const char *s)
 		}
 		else
 		{
-			size.x = MAX(size.x, TextGetStringWidth(s));
+			size.x = MAX(size.x, TextGetSubstringWidth(s, (int)strlen(s)));
 			s += strlen(s);
 		}
 	}
 	return size;
 }
 
+// Get the string's cache entry, measuring it if needed; NULL if too long
+static const TextSizeEntry *TextSizeGet(const char *s)
+{
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	size_t len;
+	TextSizeEntry *e;
+	for (len = 0; s[len] != '\0'; len++)
+	{
+		h = (h ^ (unsigned char)s[len]) * 16777619u;
+	}
+	if (len >= TEXT_SIZE_CACHE_STRLEN)
+	{
+		return NULL;
+	}
+	e = &gTextSizeCache[h % TEXT_SIZE_CACHE_COUNT];
+	// Empty entries hold the empty string, whose sizes are zero
+	if (strcmp(e->s, s) != 0)
+	{
+		const int width = TextGetSubstringWidth(s, (int)len);
+		const Vec2i size = MeasureSize(s);
+		memcpy(e->s, s, len + 1);
+		e->width = width;
+		e->size = size;
+	}
+	return e;
+}
+
+Vec2i TextGetSize(const char *s)
+{
+	const TextSizeEntry *e = TextSizeGet(s);
+	return e != NULL ? e->size : MeasureSize(s);
+}
+
 void CDogsTextGoto(int x, int y)
 {
 	xCDogsText = x;
@@ -271,7 +378,8 @@ int TextGetSubstringWidth(const char *s, int len)
 
 int TextGetStringWidth(const char *s)
 {
-	return TextGetSubstringWidth(s, (int)strlen(s));
+	const TextSizeEntry *e = TextSizeGet(s);
+	return e != NULL ? e->width : TextGetSubstringWidth(s, (int)strlen(s));
 }
 
 #define FLAG_SET(a, b)	((a & b) != 0)
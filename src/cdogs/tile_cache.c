@@ -0,0 +1,152 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "tile_cache.h"
+
+#include "blit.h"
+#include "blit_simd.h"
+#include "utils.h"
+
+#define TILE_CACHE_MIN_SIZE 64
+
+TileCache gTileCache = { NULL, 0, 0 };
+
+
+// Open addressing with linear probing; size is a power of two
+// Returns either the key's entry or the empty entry where it belongs
+static TileCacheEntry *Find(TileCache *tc, const color_t *key)
+{
+	size_t i = (((size_t)key >> 4) * 2654435761u) & (size_t)(tc->size - 1);
+	while (tc->entries[i].key != NULL && tc->entries[i].key != key)
+	{
+		i = (i + 1) & (size_t)(tc->size - 1);
+	}
+	return &tc->entries[i];
+}
+
+static void Grow(TileCache *tc)
+{
+	TileCacheEntry *old = tc->entries;
+	int oldSize = tc->size;
+	int i;
+	tc->size = MAX(TILE_CACHE_MIN_SIZE, oldSize * 2);
+	CCALLOC(tc->entries, tc->size * sizeof *tc->entries);
+	for (i = 0; i < oldSize; i++)
+	{
+		if (old[i].key != NULL)
+		{
+			*Find(tc, old[i].key) = old[i];
+		}
+	}
+	CFREE(old);
+}
+
+// Get the pic's entry, adding it if needed; NULL for empty pics
+// Finding an existing entry doesn't change the cache, so the map's tiles
+// and the tiles its triggers change to, added when the map is set up, can
+// be drawn by several threads
+static TileCacheEntry *Get(TileCache *tc, Pic *pic)
+{
+	TileCacheEntry *e;
+	int count;
+	int y;
+	if (!PicIsNotNone(pic))
+	{
+		return NULL;
+	}
+	if (tc->size > 0)
+	{
+		e = Find(tc, pic->data);
+		if (e->key != NULL)
+		{
+			return e;
+		}
+	}
+	// Keep the load factor at most a half
+	if ((tc->count + 1) * 2 > tc->size)
+	{
+		Grow(tc);
+	}
+	e = Find(tc, pic->data);
+	e->key = pic->data;
+	count = pic->size.x * pic->size.y;
+	CMALLOC(e->normal, count * sizeof *e->normal);
+	CMALLOC(e->fogged, count * sizeof *e->fogged);
+	for (y = 0; y < pic->size.y; y++)
+	{
+		const int offset = y * pic->size.x;
+		gBlitRowKernels.MaskedRow(
+			e->normal + offset, pic->data + offset, pic->size.x, colorWhite);
+		gBlitRowKernels.MaskedRow(
+			e->fogged + offset, pic->data + offset, pic->size.x, colorFog);
+	}
+	tc->count++;
+	return e;
+}
+
+void TileCacheAdd(TileCache *tc, Pic *pic)
+{
+	Get(tc, pic);
+}
+
+const Uint32 *TileCacheGetPixels(TileCache *tc, Pic *pic, int isFogged)
+{
+	TileCacheEntry *e = Get(tc, pic);
+	if (e == NULL)
+	{
+		return NULL;
+	}
+	return isFogged ? e->fogged : e->normal;
+}
+
+void TileCacheDraw(
+	TileCache *tc, GraphicsDevice *device, Pic *pic, Vec2i pos,
+	int isFogged)
+{
+	const Uint32 *pixels = TileCacheGetPixels(tc, pic, isFogged);
+	if (pixels == NULL)
+	{
+		return;
+	}
+	BlitPixels(
+		device, pixels, pic->size.x, pic->size, Vec2iAdd(pos, pic->offset));
+}
+
+void TileCacheClear(TileCache *tc)
+{
+	int i;
+	for (i = 0; i < tc->size; i++)
+	{
+		CFREE(tc->entries[i].normal);
+		CFREE(tc->entries[i].fogged);
+	}
+	CFREE(tc->entries);
+	tc->entries = NULL;
+	tc->size = 0;
+	tc->count = 0;
+}
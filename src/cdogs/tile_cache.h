@@ -0,0 +1,68 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __TILE_CACHE
+#define __TILE_CACHE
+
+#include "grafx.h"
+#include "pic.h"
+#include "vector.h"
+
+// Per-mission cache of map tile pics, pre-multiplied by the line of sight
+// masks and converted to framebuffer pixels, so that drawing a tile is a
+// straight row copy of either the normal or the fog-darkened variant.
+// Tiles are keyed by their pic data; the cache is rebuilt in SetupMap with
+// every pic that the map's tiles and triggers use. Drawing only reads it,
+// so viewports can draw from several threads; a pic missing from it is
+// added on first draw, which is only safe on a single thread.
+
+typedef struct
+{
+	const color_t *key;
+	Uint32 *normal;
+	Uint32 *fogged;
+} TileCacheEntry;
+
+typedef struct
+{
+	TileCacheEntry *entries;
+	int size;
+	int count;
+} TileCache;
+
+extern TileCache gTileCache;
+
+void TileCacheAdd(TileCache *tc, Pic *pic);
+// Get the pic's normal or fogged pixels, or NULL if the pic is empty
+const Uint32 *TileCacheGetPixels(TileCache *tc, Pic *pic, int isFogged);
+void TileCacheDraw(
+	TileCache *tc, GraphicsDevice *device, Pic *pic, Vec2i pos,
+	int isFogged);
+void TileCacheClear(TileCache *tc);
+
+#endif
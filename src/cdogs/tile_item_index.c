@@ -0,0 +1,148 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "tile_item_index.h"
+
+#include <string.h>
+
+#include "actors.h"
+#include "collision.h"
+#include "utils.h"
+
+TileItemCell gTileItemIndex[YMAX][XMAX];
+static const TileItemCell sEmptyCell = { NULL, 0, 0 };
+
+
+void TileItemIndexTerminate(void)
+{
+	int x, y;
+	for (y = 0; y < YMAX; y++)
+	{
+		for (x = 0; x < XMAX; x++)
+		{
+			CFREE(gTileItemIndex[y][x].entries);
+		}
+	}
+	memset(gTileItemIndex, 0, sizeof gTileItemIndex);
+}
+
+void TileItemIndexClear(void)
+{
+	int x, y;
+	for (y = 0; y < YMAX; y++)
+	{
+		for (x = 0; x < XMAX; x++)
+		{
+			gTileItemIndex[y][x].count = 0;
+		}
+	}
+}
+
+static TileItemCell *GetCellOfItem(const TTileItem *t)
+{
+	int x = t->x / TILE_WIDTH;
+	int y = t->y / TILE_HEIGHT;
+	return &gTileItemIndex[CLAMP(y, 0, YMAX - 1)][CLAMP(x, 0, XMAX - 1)];
+}
+
+static void SetEntry(TileItemEntry *e, TTileItem *t)
+{
+	e->item = t;
+	e->x = t->x;
+	e->y = t->y;
+	e->w = t->w;
+	e->h = t->h;
+	e->flags = t->flags;
+	e->kind = t->kind;
+	e->team = t->kind == KIND_CHARACTER ?
+		CalcCollisionTeam(1, t->actor) : COLLISIONTEAM_NONE;
+}
+
+void TileItemIndexAdd(TTileItem *t)
+{
+	TileItemCell *cell = GetCellOfItem(t);
+	if (cell->count == cell->size)
+	{
+		cell->size = cell->size == 0 ? 4 : cell->size * 2;
+		CREALLOC(cell->entries, cell->size * sizeof *cell->entries);
+	}
+	t->cell = cell;
+	t->slot = cell->count;
+	SetEntry(&cell->entries[cell->count], t);
+	cell->count++;
+}
+
+// Whether the item is in the index, as opposed to never added, removed, or
+// forgotten by a clear
+static int IsIndexed(const TTileItem *t)
+{
+	return
+		t->cell != NULL &&
+		t->slot < t->cell->count &&
+		t->cell->entries[t->slot].item == t;
+}
+
+void TileItemIndexRemove(TTileItem *t)
+{
+	TileItemCell *cell = t->cell;
+	if (IsIndexed(t))
+	{
+		cell->count--;
+		if (t->slot != cell->count)
+		{
+			// Move the last entry into the hole
+			TileItemEntry *e = &cell->entries[t->slot];
+			*e = cell->entries[cell->count];
+			e->item->slot = t->slot;
+		}
+	}
+	t->cell = NULL;
+	t->slot = 0;
+}
+
+void TileItemIndexUpdate(TTileItem *t)
+{
+	if (IsIndexed(t))
+	{
+		SetEntry(&t->cell->entries[t->slot], t);
+	}
+}
+
+const TileItemEntry *TileItemIndexGetEntry(const TTileItem *t)
+{
+	return IsIndexed(t) ? &t->cell->entries[t->slot] : NULL;
+}
+
+const TileItemCell *TileItemIndexGetCell(int x, int y)
+{
+	if (x < 0 || x >= XMAX || y < 0 || y >= YMAX)
+	{
+		return &sEmptyCell;
+	}
+	return &gTileItemIndex[y][x];
+}
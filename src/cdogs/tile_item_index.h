@@ -0,0 +1,79 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __TILE_ITEM_INDEX
+#define __TILE_ITEM_INDEX
+
+#include "map.h"
+
+// Uniform grid of the map's tile items, one cell per tile
+// Each cell keeps its items in a dense array, along with copies of the
+// fields that collision tests read, so that queries scan contiguous memory
+// instead of chasing the items themselves.
+// Items remember their cell and slot, so removal is a swap with the cell's
+// last entry.
+
+typedef struct
+{
+	TTileItem *item;
+	int x, y;
+	int w, h;
+	int flags;
+	int kind;
+	// CollisionTeam of the item
+	int team;
+} TileItemEntry;
+
+struct TileItemCell
+{
+	TileItemEntry *entries;
+	int count;
+	int size;
+};
+typedef struct TileItemCell TileItemCell;
+
+extern TileItemCell gTileItemIndex[YMAX][XMAX];
+
+void TileItemIndexTerminate(void);
+// Empty all the cells, for a new map
+// Items still in the index are forgotten, as they are about to be freed
+void TileItemIndexClear(void);
+
+// Add the item to the cell of its tile; the item must not be in the index
+void TileItemIndexAdd(TTileItem *t);
+void TileItemIndexRemove(TTileItem *t);
+// Refresh the copies of the item's fields; call after changing the item's
+// flags, size or collision team
+void TileItemIndexUpdate(TTileItem *t);
+
+// The index's entry for the item, or NULL if it isn't in the index
+const TileItemEntry *TileItemIndexGetEntry(const TTileItem *t);
+// The cell of a tile; tiles outside the map have an empty cell
+const TileItemCell *TileItemIndexGetCell(int x, int y);
+
+#endif
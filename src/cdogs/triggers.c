@@ -33,8 +33,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include "triggers.h"
+#include "automap.h"
+#include "floor_layer.h"
+#include "fov.h"
 #include "map.h"
 #include "sounds.h"
+#include "tile_item_index.h"
 #include "utils.h"
 
 static TTrigger *root = NULL;
@@ -182,6 +186,38 @@ void FreeTriggersAndWatches(void)
 	RemoveAllWatches();
 }
 
+static void ForEachAction(
+	TAction *a, void (*func)(TAction *, void *), void *data)
+{
+	for (; a->action != ACTION_NULL; a++)
+	{
+		func(a, data);
+	}
+}
+static void ForEachTriggerActionInTree(
+	TTrigger *t, void (*func)(TAction *, void *), void *data)
+{
+	if (!t)
+		return;
+
+	ForEachTriggerActionInTree(t->left, func, data);
+	ForEachTriggerActionInTree(t->right, func, data);
+	ForEachAction(t->actions, func, data);
+}
+void ForEachTriggerAction(void (*func)(TAction *, void *), void *data)
+{
+	TWatch *t;
+	ForEachTriggerActionInTree(root, func, data);
+	for (t = activeWatches; t; t = t->next)
+	{
+		ForEachAction(t->actions, func, data);
+	}
+	for (t = inactiveWatches; t; t = t->next)
+	{
+		ForEachAction(t->actions, func, data);
+	}
+}
+
 static void Action(TAction * a)
 {
 	TWatch *t;
@@ -210,6 +246,12 @@ static void Action(TAction * a)
 			Map(a->x, a->y).flags = a->tileFlags;
 			Map(a->x, a->y).pic = a->tilePic;
 			Map(a->x, a->y).picAlt = a->tilePicAlt;
+			FloorLayerUpdateTile(&gFloorLayer, Vec2iNew(a->x, a->y));
+			if (MapBitsUpdateTile(Vec2iNew(a->x, a->y)) & MAPTILE_NO_SEE)
+			{
+				FOVMapChanged();
+			}
+			AutomapUpdateTile(Vec2iNew(a->x, a->y));
 			break;
 
 		case ACTION_SETTIMEDWATCH:
@@ -256,7 +298,7 @@ static int ConditionMet(TCondition *c)
 			break;
 
 		case CONDITION_TILECLEAR:
-			if (Map(c->x, c->y).things != NULL)
+			if (TileItemIndexGetCell(c->x, c->y)->count > 0)
 				return 0;
 			break;
 		}
@@ -105,6 +105,8 @@ void UpdateWatches(void);
 TTrigger *AddTrigger(int x, int y, int actionCount);
 TWatch *AddWatch(int conditionCount, int actionCount);
 void FreeTriggersAndWatches(void);
+// Call func on every action of every trigger and watch
+void ForEachTriggerAction(void (*func)(TAction *, void *), void *data);
 
 
 #endif
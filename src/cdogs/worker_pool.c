@@ -0,0 +1,167 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "worker_pool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <SDL.h>
+
+#include "utils.h"
+
+WorkerPool gWorkerPool;
+
+
+// Take and run parts until there are none left; call with the lock held
+static void RunParts(WorkerPool *pool)
+{
+	while (pool->nextPart < pool->partCount)
+	{
+		const int part = pool->nextPart++;
+		SDL_UnlockMutex(pool->lock);
+		pool->func(pool->data, part, pool->partCount);
+		SDL_LockMutex(pool->lock);
+		pool->partsLeft--;
+		if (pool->partsLeft == 0)
+		{
+			SDL_CondSignal(pool->done);
+		}
+	}
+}
+
+static int WorkerThread(void *data)
+{
+	WorkerPool *pool = data;
+	SDL_LockMutex(pool->lock);
+	for (;;)
+	{
+		while (!pool->quit && pool->nextPart >= pool->partCount)
+		{
+			SDL_CondWait(pool->start, pool->lock);
+		}
+		if (pool->quit)
+		{
+			break;
+		}
+		RunParts(pool);
+	}
+	SDL_UnlockMutex(pool->lock);
+	return 0;
+}
+
+void WorkerPoolInit(WorkerPool *pool, int threadCount)
+{
+	int i;
+	memset(pool, 0, sizeof *pool);
+	pool->lock = SDL_CreateMutex();
+	pool->start = SDL_CreateCond();
+	pool->done = SDL_CreateCond();
+	if (threadCount > 0)
+	{
+		CCALLOC(pool->threads, threadCount * sizeof *pool->threads);
+	}
+	for (i = 0; i < threadCount; i++)
+	{
+		pool->threads[i] = SDL_CreateThread(WorkerThread, pool);
+		if (pool->threads[i] == NULL)
+		{
+			printf("Cannot create worker thread: %s\n", SDL_GetError());
+			break;
+		}
+		pool->threadCount++;
+	}
+}
+
+void WorkerPoolTerminate(WorkerPool *pool)
+{
+	int i;
+	if (pool->lock == NULL)
+	{
+		return;
+	}
+	SDL_LockMutex(pool->lock);
+	pool->quit = 1;
+	SDL_CondBroadcast(pool->start);
+	SDL_UnlockMutex(pool->lock);
+	for (i = 0; i < pool->threadCount; i++)
+	{
+		SDL_WaitThread(pool->threads[i], NULL);
+	}
+	CFREE(pool->threads);
+	SDL_DestroyCond(pool->start);
+	SDL_DestroyCond(pool->done);
+	SDL_DestroyMutex(pool->lock);
+	memset(pool, 0, sizeof *pool);
+}
+
+void WorkerPoolRun(
+	WorkerPool *pool, WorkerJobFunc func, void *data, int partCount)
+{
+	int i;
+	if (pool->threadCount == 0 || partCount == 1)
+	{
+		for (i = 0; i < partCount; i++)
+		{
+			func(data, i, partCount);
+		}
+		return;
+	}
+	SDL_LockMutex(pool->lock);
+	pool->func = func;
+	pool->data = data;
+	pool->partCount = partCount;
+	pool->nextPart = 0;
+	pool->partsLeft = partCount;
+	SDL_CondBroadcast(pool->start);
+	RunParts(pool);
+	while (pool->partsLeft > 0)
+	{
+		SDL_CondWait(pool->done, pool->lock);
+	}
+	SDL_UnlockMutex(pool->lock);
+}
+
+int GetCPUCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return MAX(1, (int)info.dwNumberOfProcessors);
+#elif defined(_SC_NPROCESSORS_ONLN)
+	return MAX(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+#else
+	return 1;
+#endif
+}
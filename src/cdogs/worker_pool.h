@@ -0,0 +1,69 @@
+/*
+    C-Dogs SDL
+    A port of the legendary (and fun) action/arcade cdogs.
+
+    Copyright (c) 2013, Cong Xu
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this
+    list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __WORKER_POOL
+#define __WORKER_POOL
+
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
+// Persistent pool of worker threads, for jobs split into independent parts,
+// such as bands of rows. The calling thread works on parts too, so a pool
+// of n - 1 threads runs n parts at once.
+
+typedef void (*WorkerJobFunc)(void *data, int part, int partCount);
+
+typedef struct
+{
+	SDL_Thread **threads;
+	int threadCount;
+	SDL_mutex *lock;
+	// Signalled when a job starts or the pool quits
+	SDL_cond *start;
+	// Signalled when the last part of a job is done
+	SDL_cond *done;
+	WorkerJobFunc func;
+	void *data;
+	int partCount;
+	int nextPart;
+	int partsLeft;
+	int quit;
+} WorkerPool;
+
+extern WorkerPool gWorkerPool;
+
+void WorkerPoolInit(WorkerPool *pool, int threadCount);
+void WorkerPoolTerminate(WorkerPool *pool);
+// Run func for parts 0 to partCount - 1, returning once all are done
+void WorkerPoolRun(
+	WorkerPool *pool, WorkerJobFunc func, void *data, int partCount);
+
+// Number of logical CPUs, at least 1
+int GetCPUCount(void);
+
+#endif
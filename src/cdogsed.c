@@ -390,7 +390,7 @@ void DrawObjectiveInfo(int idx, int y, int xc)
 	if (pic.picIndex >= 0)
 	{
 		DrawTTPic(
-			60 + pic.dx, y + 8 + pic.dy,
+			&gGraphicsDevice, 60 + pic.dx, y + 8 + pic.dy,
 			PicManagerGetOldPic(&gPicManager, pic.picIndex), table);
 	}
 
@@ -524,7 +524,7 @@ void DisplayMapItem(int x, int y, TMapObject * mo, int density, int hilite)
 
 	const TOffsetPic *pic = &cGeneralPics[mo->pic];
 	DrawTPic(
-		x + pic->dx, y + pic->dy,
+		&gGraphicsDevice, x + pic->dx, y + pic->dy,
 		PicManagerGetOldPic(&gPicManager, pic->picIndex));
 
 	if (hilite) {
@@ -549,7 +549,7 @@ static void DrawStyleArea(
 	char buf[16];
 	DisplayCDogsText(pos.x, pos.y, name, isHighlighted, 0);
 	DrawPic(
-		pos.x, pos.y + TH,
+		&gGraphicsDevice, pos.x, pos.y + TH,
 		pic);
 	// Display style index and count, right aligned
 	sprintf(buf, "%d/%d", index + 1, count);
@@ -776,7 +776,8 @@ static void Display(int mission, int xc, int yc, int willDisplayAutomap)
 
 	if (fileChanged)
 	{
-		DrawTPic(10, y, PicManagerGetOldPic(&gPicManager, 221));
+		DrawTPic(
+			&gGraphicsDevice, 10, y, PicManagerGetOldPic(&gPicManager, 221));
 	}
 
 	DrawTextString("Press F1 for help", &gGraphicsDevice, Vec2iNew(20, 200));
@@ -1408,7 +1409,7 @@ static void Setup(int idx, int buildTables)
 	// Clear background first
 	for (i = 0; i < GraphicsGetScreenSize(&gGraphicsDevice.cachedConfig); i++)
 	{
-		gGraphicsDevice.buf[i] = PixelFromColor(&gGraphicsDevice, colorBlack);
+		gGraphicsDevice.buf[i] = PixelFromColor(colorBlack);
 	}
 	GrafxMakeBackground(&gGraphicsDevice, &gConfig.Graphics, tintDarker, idx);
 }
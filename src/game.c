@@ -68,11 +68,13 @@
 #include <cdogs/mission.h>
 #include <cdogs/music.h>
 #include <cdogs/objs.h>
+#include <cdogs/overdraw.h>
 #include <cdogs/palette.h>
 #include <cdogs/pic_manager.h>
 #include <cdogs/pics.h>
 #include <cdogs/text.h>
 #include <cdogs/triggers.h>
+#include <cdogs/worker_pool.h>
 
 #include <cdogs/drawtools.h> /* for Draw_Box and Draw_Point */
 
@@ -197,14 +199,117 @@ static void Ticks_FrameEnd(void)
 }
 
 
+// Field of view of the camera when no players are alive
+static FOV sCameraFOV;
+
+static const FOVBits *UpdateFOV(FOV *fov, Vec2i center)
+{
+	return FOVUpdate(
+		fov,
+		Vec2iNew(center.x / TILE_WIDTH, center.y / TILE_HEIGHT),
+		MAX(gConfig.Game.SightRange, 0));
+}
+
+// Viewports to draw
+// They are set up one at a time, since that updates the map and actors,
+// and then drawn all at once: each viewport's blits are recorded on its own
+// thread, then the screen tiles (bins) of all of them are drawn in parallel
+typedef struct
+{
+	DrawContext *contexts[MAX_PLAYERS];
+	Vec2i offsets[MAX_PLAYERS];
+	// Index of each viewport's first bin, out of all the viewports' bins
+	int binStarts[MAX_PLAYERS + 1];
+	int count;
+} ViewportList;
+static WorkerPool sDrawPool;
+// Set by the debug key to dump the next frame's overdraw
+static int sIsOverdrawDumpRequested = 0;
+
+static void RecordViewport(void *data, int part, int partCount)
+{
+	ViewportList *vl = data;
+	UNUSED(partCount);
+	DrawBufferRecord(vl->contexts[part], vl->offsets[part]);
+}
+static void DrawViewportBin(void *data, int part, int partCount)
+{
+	ViewportList *vl = data;
+	int i = 0;
+	UNUSED(partCount);
+	while (part >= vl->binStarts[i + 1])
+	{
+		i++;
+	}
+	DrawContextDrawBin(vl->contexts[i], part - vl->binStarts[i]);
+}
+
 static void DoBuffer(
-	DrawBuffer *b, Vec2i center, int w, Vec2i noise, Vec2i offset)
+	ViewportList *vl, DrawContext *c, Vec2i center, int w, Vec2i noise,
+	Vec2i offset, FOV *fov)
 {
 	DrawBufferSetFromMap(
-		b, gMap, Vec2iAdd(center, noise), w, Vec2iNew(X_TILES, Y_TILES));
-	LineOfSight(center, b);
-	FixBuffer(b);
-	DrawBufferDraw(b, offset);
+		&c->buffer, gMap, Vec2iAdd(center, noise), w,
+		Vec2iNew(X_TILES, Y_TILES));
+	FixBuffer(&c->buffer, UpdateFOV(fov, center));
+	vl->contexts[vl->count] = c;
+	vl->offsets[vl->count] = offset;
+	vl->count++;
+}
+
+static void DumpOverdraw(const ViewportList *vl)
+{
+	const char *filename = "overdraw.bmp";
+	Overdraw o;
+	int i;
+	OverdrawInit(
+		&o,
+		Vec2iNew(
+			gGraphicsDevice.cachedConfig.ResolutionWidth,
+			gGraphicsDevice.cachedConfig.ResolutionHeight));
+	for (i = 0; i < vl->count; i++)
+	{
+		OverdrawAdd(&o, vl->contexts[i]);
+	}
+	printf(
+		"Overdraw: %d pixels written %d times, %.2f writes per pixel\n",
+		o.pixelsWritten, o.writes,
+		o.pixelsWritten > 0 ? (double)o.writes / o.pixelsWritten : 0.0);
+	if (OverdrawSave(&o, filename))
+	{
+		printf("Overdraw heatmap saved to %s\n", filename);
+	}
+	else
+	{
+		printf("Cannot save overdraw heatmap: %s\n", SDL_GetError());
+	}
+	OverdrawTerminate(&o);
+}
+
+static void DrawViewports(ViewportList *vl)
+{
+	int i;
+	if (vl->count == 0)
+	{
+		return;
+	}
+	if (sDrawPool.lock == NULL)
+	{
+		WorkerPoolInit(&sDrawPool, GetCPUCount() - 1);
+	}
+	WorkerPoolRun(&sDrawPool, RecordViewport, vl, vl->count);
+	vl->binStarts[0] = 0;
+	for (i = 0; i < vl->count; i++)
+	{
+		vl->binStarts[i + 1] =
+			vl->binStarts[i] + DrawContextGetBinCount(vl->contexts[i]);
+	}
+	WorkerPoolRun(&sDrawPool, DrawViewportBin, vl, vl->binStarts[vl->count]);
+	if (sIsOverdrawDumpRequested)
+	{
+		DumpOverdraw(vl);
+		sIsOverdrawDumpRequested = 0;
+	}
 }
 
 int GetShakeAmount(int oldShake, int amount)
@@ -234,8 +339,11 @@ int IsSingleScreen(GraphicsConfig *config, SplitscreenStyle splitscreenStyle)
 		max.y - min.y < config->ResolutionHeight - SPLIT_PADDING;
 }
 
-Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
+Vec2i DrawScreen(
+	DrawContext viewports[MAX_PLAYERS], Vec2i lastPosition, int shakeAmount)
 {
+	static FOVBits visible;
+	ViewportList vl;
 	Vec2i noise = Vec2iZero();
 	Vec2i centerOffset = Vec2iNew(-TILE_WIDTH / 2 - 8, -TILE_HEIGHT / 2 - 4);
 	int i;
@@ -251,21 +359,31 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 
 	for (i = 0; i < GraphicsGetScreenSize(&gGraphicsDevice.cachedConfig); i++)
 	{
-		gGraphicsDevice.buf[i] = PixelFromColor(&gGraphicsDevice, colorBlack);
+		gGraphicsDevice.buf[i] = PixelFromColor(colorBlack);
 	}
 
 	GraphicsResetBlitClip(&gGraphicsDevice);
+	vl.count = 0;
 	if (numPlayersAlive == 0)
 	{
-		DoBuffer(b, lastPosition, X_TILES, noise, centerOffset);
+		DrawContextSetDevice(
+			&viewports[0], &gGraphicsDevice, 0, 0, w - 1, h - 1);
+		DoBuffer(
+			&vl, &viewports[0], lastPosition, X_TILES, noise, centerOffset,
+			&sCameraFOV);
 	}
 	else
 	{
 		if (numPlayersAlive == 1)
 		{
-			TActor *p = GetFirstAlivePlayer();
+			const int idx = GetFirstAlivePlayerIndex();
+			TActor *p = gPlayers[idx];
 			Vec2i center = Vec2iNew(p->tileItem.x, p->tileItem.y);
-			DoBuffer(b, center, X_TILES, noise, centerOffset);
+			DrawContextSetDevice(
+				&viewports[0], &gGraphicsDevice, 0, 0, w - 1, h - 1);
+			DoBuffer(
+				&vl, &viewports[0], center, X_TILES, noise, centerOffset,
+				&gPlayerFOV[idx]);
 			SoundSetEars(center);
 			lastPosition = center;
 		}
@@ -276,23 +394,32 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 			// One screen
 			lastPosition = PlayersGetMidpoint(gPlayers);
 
+			DrawContextSetDevice(
+				&viewports[0], &gGraphicsDevice, 0, 0, w - 1, h - 1);
 			DrawBufferSetFromMap(
-				b, gMap,
+				&viewports[0].buffer, gMap,
 				Vec2iAdd(lastPosition, noise),
 				X_TILES,
 				Vec2iNew(X_TILES, Y_TILES));
+			// Everything seen by any player
+			FOVBitsClear(&visible);
 			for (i = 0; i < MAX_PLAYERS; i++)
 			{
 				if (IsPlayerAlive(i))
 				{
-					LineOfSight(
-						Vec2iNew(
-							gPlayers[i]->tileItem.x, gPlayers[i]->tileItem.y),
-						b);
+					FOVBitsOr(
+						&visible,
+						UpdateFOV(
+							&gPlayerFOV[i],
+							Vec2iNew(
+								gPlayers[i]->tileItem.x,
+								gPlayers[i]->tileItem.y)));
 				}
 			}
-			FixBuffer(b);
-			DrawBufferDraw(b, centerOffset);
+			FixBuffer(&viewports[0].buffer, &visible);
+			vl.contexts[0] = &viewports[0];
+			vl.offsets[0] = centerOffset;
+			vl.count = 1;
 			SoundSetEars(lastPosition);
 		}
 		else if (gOptions.numPlayers == 2)
@@ -306,13 +433,16 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 				Vec2i centerOffsetPlayer = centerOffset;
 				int clipLeft = (i & 1) ? w / 2 : 0;
 				int clipRight = (i & 1) ? w - 1 : (w / 2) - 1;
-				GraphicsSetBlitClip(
-					&gGraphicsDevice, clipLeft, 0, clipRight, h - 1);
+				DrawContextSetDevice(
+					&viewports[i], &gGraphicsDevice,
+					clipLeft, 0, clipRight, h - 1);
 				if (i == 1)
 				{
 					centerOffsetPlayer.x += w / 2;
 				}
-				DoBuffer(b, center, X_TILES_HALF, noise, centerOffsetPlayer);
+				DoBuffer(
+					&vl, &viewports[i], center, X_TILES_HALF, noise,
+					centerOffsetPlayer, &gPlayerFOV[i]);
 				if (i == 0)
 				{
 					SoundSetLeftEars(center);
@@ -323,6 +453,8 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 					SoundSetRightEars(center);
 				}
 			}
+			DrawViewports(&vl);
+			vl.count = 0;
 			Draw_Line(w / 2 - 1, 0, w / 2 - 1, h - 1, colorBlack);
 			Draw_Line(w / 2, 0, w / 2, h - 1, colorBlack);
 		}
@@ -333,18 +465,21 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 			{
 				Vec2i center;
 				Vec2i centerOffsetPlayer = centerOffset;
+				// The viewports mustn't overlap, as their bins are drawn in
+				// parallel; the rows where they meet are covered by the
+				// dividing lines anyway
 				int clipLeft = (i & 1) ? w / 2 : 0;
-				int clipTop = (i < 2) ? 0 : h / 2 - 1;
+				int clipTop = (i < 2) ? 0 : h / 2;
 				int clipRight = (i & 1) ? w - 1 : (w / 2) - 1;
-				int clipBottom = (i < 2) ? h / 2 : h - 1;
+				int clipBottom = (i < 2) ? (h / 2) - 1 : h - 1;
 				if (!IsPlayerAlive(i))
 				{
 					continue;
 				}
 				center = Vec2iNew(
 					gPlayers[i]->tileItem.x, gPlayers[i]->tileItem.y);
-				GraphicsSetBlitClip(
-					&gGraphicsDevice,
+				DrawContextSetDevice(
+					&viewports[i], &gGraphicsDevice,
 					clipLeft, clipTop, clipRight, clipBottom);
 				if (i & 1)
 				{
@@ -358,7 +493,9 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 				{
 					centerOffsetPlayer.y += h / 4;
 				}
-				DoBuffer(b, center, X_TILES_HALF, noise, centerOffsetPlayer);
+				DoBuffer(
+					&vl, &viewports[i], center, X_TILES_HALF, noise,
+					centerOffsetPlayer, &gPlayerFOV[i]);
 
 				// Set the sound "ears"
 				// If any player is dead, that ear reverts to the other ear
@@ -432,6 +569,8 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 					lastPosition = center;
 				}
 			}
+			DrawViewports(&vl);
+			vl.count = 0;
 			Draw_Line(w / 2 - 1, 0, w / 2 - 1, h - 1, colorBlack);
 			Draw_Line(w / 2, 0, w / 2, h - 1, colorBlack);
 			Draw_Line(0, h / 2 - 1, w - 1, h / 2 - 1, colorBlack);
@@ -442,6 +581,7 @@ Vec2i DrawScreen(DrawBuffer *b, Vec2i lastPosition, int shakeAmount)
 			assert(0 && "not implemented yet");
 		}
 	}
+	DrawViewports(&vl);
 	GraphicsResetBlitClip(&gGraphicsDevice);
 	return lastPosition;
 }
@@ -552,6 +692,12 @@ int HandleKey(int cmd, int *isPaused)
 		*isPaused = 0;
 	}
 
+	// Debug: dump the overdraw of the next frame
+	if (debug && KeyIsPressed(&gInputDevices.keyboard, SDLK_F9))
+	{
+		sIsOverdrawDumpRequested = 1;
+	}
+
 	if (KeyIsPressed(&gInputDevices.keyboard, SDLK_ESCAPE) ||
 		JoyIsPressed(&gInputDevices.joysticks.joys[0], CMD_BUTTON4) ||
 		JoyIsPressed(&gInputDevices.joysticks.joys[1], CMD_BUTTON4))
@@ -632,14 +778,18 @@ void HandleGameEvents(GameEventStore *store, int *shakeAmount)
 
 int gameloop(void)
 {
-	DrawBuffer buffer;
+	DrawContext viewports[MAX_PLAYERS];
+	int i;
 	int is_esc_pressed = 0;
 	int isDone = 0;
 	int isPaused = 0;
 	HUD hud;
 	Vec2i lastPosition = Vec2iZero();
 
-	DrawBufferInit(&buffer, Vec2iNew(X_TILES, Y_TILES));
+	for (i = 0; i < MAX_PLAYERS; i++)
+	{
+		DrawContextInit(&viewports[i], Vec2iNew(X_TILES, Y_TILES));
+	}
 	HUDInit(&hud, &gConfig.Interface, &gGraphicsDevice, &gMission);
 	GameEventsInit(&gGameEvents);
 
@@ -655,7 +805,6 @@ int gameloop(void)
 		int cmds[MAX_PLAYERS];
 		int cmdAll = 0;
 		int ticks = 1;
-		int i;
 		int shakeAmount = 0;
 		int allPlayersDestroyed = 1;
 		Ticks_Update();
@@ -839,7 +988,7 @@ int gameloop(void)
 			isDone = 1;
 		}
 
-		lastPosition = DrawScreen(&buffer, lastPosition, shakeAmount);
+		lastPosition = DrawScreen(viewports, lastPosition, shakeAmount);
 
 		shakeAmount -= ticks;
 		if (shakeAmount < 0)
@@ -861,12 +1010,17 @@ int gameloop(void)
 			MouseDraw(&gInputDevices.mouse);
 		}
 
-		BlitFlip(&gGraphicsDevice, &gConfig.Graphics);
+		BlitFlipAsync(&gGraphicsDevice, &gConfig.Graphics);
 
 		Ticks_FrameEnd();
 	}
+	BlitFlipFlush();
 	GameEventsTerminate(&gGameEvents);
-	DrawBufferTerminate(&buffer);
+	WorkerPoolTerminate(&sDrawPool);
+	for (i = 0; i < MAX_PLAYERS; i++)
+	{
+		DrawContextTerminate(&viewports[i]);
+	}
 
 	return !is_esc_pressed;
 }
@@ -484,7 +484,7 @@ void MenuDisplayItems(MenuSystem *ms)
 	{
 		PicPaletted *logo = PicManagerGetOldPic(&gPicManager, PIC_LOGO);
 		DrawTPic(
-			MS_CENTER_X(*ms, logo->w),
+			&gGraphicsDevice, MS_CENTER_X(*ms, logo->w),
 			ms->pos.y + ms->size.y / 12,
 			logo);
 		DrawTextStringSpecial(
@@ -965,7 +965,8 @@ int KeyAvailable(int key, int code, input_keys_t *keys, input_keys_t *keysOther)
 {
 	key_code_e i;
 
-	if (key == SDLK_ESCAPE || key == SDLK_F9 || key == SDLK_F10)
+	// F9 dumps the overdraw when debugging
+	if (key == SDLK_ESCAPE || (debug && key == SDLK_F9) || key == SDLK_F10)
 	{
 		return 0;
 	}
@@ -0,0 +1,225 @@
+#include <cbehave/cbehave.h>
+
+#include <actor_grid.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ACTOR_COUNT 400
+#define MAP_W (XMAX * TILE_WIDTH * 256)
+#define MAP_H (YMAX * TILE_HEIGHT * 256)
+
+static TActor sActors[ACTOR_COUNT];
+static int sIsAdded[ACTOR_COUNT];
+static int sSerial;
+static struct PlayerData sPlayerData;
+
+static void ClearActors(void)
+{
+	ActorGridClear();
+	memset(sActors, 0, sizeof sActors);
+	memset(sIsAdded, 0, sizeof sIsAdded);
+	sSerial = 0;
+}
+
+// A new actor, good or bad, some of them players, victims or dead
+static void AddRandomActor(int i)
+{
+	TActor *a = &sActors[i];
+	if (sIsAdded[i])
+	{
+		ActorGridRemove(a);
+	}
+	memset(a, 0, sizeof *a);
+	a->serial = sSerial++;
+	a->pData = rand() % 10 == 0 ? &sPlayerData : NULL;
+	a->flags =
+		(rand() % 3 == 0 ? FLAGS_GOOD_GUY : 0) |
+		(rand() % 8 == 0 ? FLAGS_VICTIM : 0);
+	a->dead = rand() % 6 == 0;
+	sIsAdded[i] = 1;
+}
+
+// Move an actor anywhere, or to one of a few spots so that actors are
+// often equally far from a point
+static void MoveRandomActor(int i, int isCoarse)
+{
+	TActor *a = &sActors[i];
+	if (isCoarse)
+	{
+		a->x = (rand() % 32) * MAP_W / 32;
+		a->y = (rand() % 32) * MAP_H / 32;
+	}
+	else
+	{
+		a->x = rand() % MAP_W;
+		a->y = rand() % MAP_H;
+	}
+	ActorGridMove(a);
+}
+
+// The closest actor as documented by ActorGridGetClosest, by checking
+// every actor; ties go to the newest
+static TActor *GetClosestByScan(
+	Vec2i pos, CollisionTeam team, int excludeFlags, int playersOnly,
+	int maxRadius)
+{
+	TActor *closest = NULL;
+	int minDistance = 0;
+	int i;
+	for (i = 0; i < ACTOR_COUNT; i++)
+	{
+		TActor *a = &sActors[i];
+		int distance;
+		if (!sIsAdded[i] ||
+			ActorGridTeam(a) != team ||
+			(a->flags & excludeFlags) ||
+			(playersOnly && (a->pData == NULL || a->dead)))
+		{
+			continue;
+		}
+		distance = CHEBYSHEV_DISTANCE(pos.x, pos.y, a->x, a->y);
+		if (maxRadius >= 0 && distance > maxRadius)
+		{
+			continue;
+		}
+		if (closest == NULL || distance < minDistance ||
+			(distance == minDistance && a->serial > closest->serial))
+		{
+			closest = a;
+			minDistance = distance;
+		}
+	}
+	return closest;
+}
+
+// Make random changes to the actors, and compare queries of both teams
+// against a scan of every actor
+// Returns the number of queries that differ
+static int CountRandomMismatches(int isCoarse)
+{
+	int mismatches = 0;
+	int step;
+	ClearActors();
+	for (step = 0; step < 100000; step++)
+	{
+		const int i = rand() % ACTOR_COUNT;
+		switch (rand() % 5)
+		{
+		case 0:
+			AddRandomActor(i);
+			MoveRandomActor(i, isCoarse);
+			break;
+		case 1:
+		case 2:
+			if (sIsAdded[i])
+			{
+				MoveRandomActor(i, isCoarse);
+			}
+			break;
+		case 3:
+			ActorGridRemove(&sActors[i]);
+			sIsAdded[i] = 0;
+			break;
+		default:
+			{
+				// Points off the map too, and a radius that is often
+				// smaller than the distance to the closest actor
+				const Vec2i pos = Vec2iNew(
+					rand() % (MAP_W + 2000) - 1000,
+					rand() % (MAP_H + 2000) - 1000);
+				const int radius = rand() % 40000;
+				const int exclude = FLAGS_INVULNERABLE | FLAGS_VICTIM;
+				mismatches +=
+					ActorGridGetClosest(
+					pos, COLLISIONTEAM_GOOD, exclude, 0, -1) !=
+					GetClosestByScan(pos, COLLISIONTEAM_GOOD, exclude, 0, -1);
+				mismatches +=
+					ActorGridGetClosest(
+					pos, COLLISIONTEAM_BAD, exclude, 0, -1) !=
+					GetClosestByScan(pos, COLLISIONTEAM_BAD, exclude, 0, -1);
+				mismatches +=
+					ActorGridGetClosest(
+					pos, COLLISIONTEAM_GOOD, 0, 1, radius) !=
+					GetClosestByScan(pos, COLLISIONTEAM_GOOD, 0, 1, radius);
+			}
+			break;
+		}
+	}
+	ActorGridClear();
+	return mismatches;
+}
+
+
+FEATURE(1, "Closest actor")
+	SCENARIO("Break ties by age")
+	{
+		TActor *closest;
+		GIVEN("two bad guys equally far from a point")
+			ClearActors();
+			sActors[0].serial = 0;
+			sActors[0].x = 1000;
+			sActors[0].y = 1000;
+			sActors[1].serial = 1;
+			sActors[1].x = 3000;
+			sActors[1].y = 1000;
+			ActorGridMove(&sActors[1]);
+			ActorGridMove(&sActors[0]);
+		GIVEN_END
+
+		WHEN("I look for the closest bad guy")
+			closest = ActorGridGetClosest(
+				Vec2iNew(2000, 1000), COLLISIONTEAM_BAD, 0, 0, -1);
+			ActorGridClear();
+		WHEN_END
+
+		THEN("the newer one should be closest");
+			SHOULD_PTR_EQUAL(closest, &sActors[1]);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Closest actors on random layouts")
+	{
+		int mismatches;
+		GIVEN("actors of both teams anywhere on the map")
+			srand(1);
+		GIVEN_END
+
+		WHEN("I look for the closest actors of each team")
+			mismatches = CountRandomMismatches(0);
+		WHEN_END
+
+		THEN("the grid should find the same actors as a scan");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Closest actors with ties")
+	{
+		int mismatches;
+		GIVEN("actors of both teams on a few spots")
+			srand(2);
+		GIVEN_END
+
+		WHEN("I look for the closest actors of each team")
+			mismatches = CountRandomMismatches(1);
+		WHEN_END
+
+		THEN("the grid should break ties as a scan does");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+FEATURE_END
+
+int main(void)
+{
+	cbehave_feature features[] =
+	{
+		{feature_idx(1)}
+	};
+
+	return cbehave_runner("Actor grid features are:", features);
+}
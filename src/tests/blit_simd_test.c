@@ -0,0 +1,170 @@
+#include <cbehave/cbehave.h>
+
+#include <blit_simd.h>
+
+#include <string.h>
+
+#define ROW_LEN 67
+
+// Compare a SIMD level's kernels against the scalar ones, on every
+// channel/mask value pair and on rows of mixed black and non-black pixels,
+// and the scaler kernels on every byte pair and every row length
+// Returns the number of mismatching rows; 0 if the level isn't supported
+static int CompareKernels(BlitSIMD simd)
+{
+	BlitRowKernels scalar, kernels;
+	color_t src[256];
+	uint32_t expected[256], actual[256];
+	unsigned char expectedOpaque[256], actualOpaque[256];
+	uint32_t pixelsA[256], pixelsB[256];
+	uint32_t expectedRow[ROW_LEN * 4], actualRow[ROW_LEN * 4];
+	unsigned int seed = 1;
+	int mismatches = 0;
+	int i, m;
+	if (BlitSIMDDetect() < simd || !BlitRowKernelsGet(&kernels, simd))
+	{
+		return 0;
+	}
+	BlitRowKernelsGet(&scalar, BLIT_SIMD_NONE);
+
+	// Every channel value against every mask value
+	for (i = 0; i < 256; i++)
+	{
+		src[i].r = (uint8_t)i;
+		src[i].g = (uint8_t)(255 - i);
+		src[i].b = (uint8_t)(i * 7);
+		src[i].a = (uint8_t)(i * 13);
+	}
+	for (m = 0; m < 256; m++)
+	{
+		color_t mask;
+		mask.r = (uint8_t)m;
+		mask.g = (uint8_t)(m * 3);
+		mask.b = (uint8_t)(255 - m);
+		mask.a = 255;
+		scalar.MaskedRow(expected, src, 256, mask);
+		kernels.MaskedRow(actual, src, 256, mask);
+		mismatches += memcmp(expected, actual, sizeof expected) != 0;
+	}
+
+	// Rows with black pixels, including black with alpha set,
+	// and lengths that leave partial vectors at the end
+	for (i = 0; i < 256; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		src[i].r = (uint8_t)(seed >> 8);
+		src[i].g = (uint8_t)(seed >> 16);
+		src[i].b = (uint8_t)(seed >> 24);
+		src[i].a = (uint8_t)seed;
+		if ((seed >> 4) % 3 == 0)
+		{
+			src[i].r = src[i].g = src[i].b = 0;
+		}
+	}
+	for (i = 0; i <= ROW_LEN; i++)
+	{
+		color_t mask;
+		int j;
+		mask.r = (uint8_t)(i * 37);
+		mask.g = (uint8_t)(i * 91);
+		mask.b = (uint8_t)(255 - i);
+		mask.a = 255;
+		for (j = 0; j < 256; j++)
+		{
+			expected[j] = actual[j] = 0xDEADBEEF + (uint32_t)j;
+		}
+		scalar.MaskedRowTransparent(expected, src + i, i, mask);
+		kernels.MaskedRowTransparent(actual, src + i, i, mask);
+		mismatches += memcmp(expected, actual, sizeof expected) != 0;
+
+		memset(expectedOpaque, 2, sizeof expectedOpaque);
+		memset(actualOpaque, 2, sizeof actualOpaque);
+		scalar.OpaqueMaskRow(expectedOpaque, src + i, i);
+		kernels.OpaqueMaskRow(actualOpaque, src + i, i);
+		mismatches +=
+			memcmp(expectedOpaque, actualOpaque, sizeof expectedOpaque) != 0;
+	}
+
+	// Every pair of byte values, with the pair differing in each byte
+	for (m = 0; m < 256; m++)
+	{
+		for (i = 0; i < 256; i++)
+		{
+			pixelsA[i] = (uint32_t)i * 0x01010101u;
+			pixelsB[i] =
+				(uint32_t)((i + m) & 0xFF) |
+				(uint32_t)((i * 3 + m) & 0xFF) << 8 |
+				(uint32_t)((i + m * 5) & 0xFF) << 16 |
+				(uint32_t)((255 - i + m) & 0xFF) << 24;
+		}
+		scalar.AvgRow(expected, pixelsA, pixelsB, 256);
+		kernels.AvgRow(actual, pixelsA, pixelsB, 256);
+		mismatches += memcmp(expected, actual, sizeof expected) != 0;
+		scalar.ThirdsRow(expected, pixelsA, pixelsB, 256);
+		kernels.ThirdsRow(actual, pixelsA, pixelsB, 256);
+		mismatches += memcmp(expected, actual, sizeof expected) != 0;
+	}
+	for (i = 0; i <= ROW_LEN; i++)
+	{
+		const uint32_t *rows[4];
+		int f;
+		rows[0] = pixelsA;
+		rows[1] = pixelsB + 1;
+		rows[2] = pixelsA + 3;
+		rows[3] = pixelsB + 7;
+		for (f = 1; f <= 4; f++)
+		{
+			memset(expectedRow, 0, sizeof expectedRow);
+			memset(actualRow, 0, sizeof actualRow);
+			scalar.InterleaveRow(expectedRow, rows, f, i);
+			kernels.InterleaveRow(actualRow, rows, f, i);
+			mismatches +=
+				memcmp(expectedRow, actualRow, sizeof expectedRow) != 0;
+		}
+	}
+	return mismatches;
+}
+
+FEATURE(1, "SIMD blit kernels")
+	SCENARIO("SSE2 kernels")
+	{
+		int mismatches;
+		GIVEN("the scalar and SSE2 blit kernels")
+		GIVEN_END
+
+		WHEN("I run them on the same pixels")
+			mismatches = CompareKernels(BLIT_SIMD_SSE2);
+		WHEN_END
+
+		THEN("the results should be bit-exact");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("AVX2 kernels")
+	{
+		int mismatches;
+		GIVEN("the scalar and AVX2 blit kernels")
+		GIVEN_END
+
+		WHEN("I run them on the same pixels")
+			mismatches = CompareKernels(BLIT_SIMD_AVX2);
+		WHEN_END
+
+		THEN("the results should be bit-exact");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+FEATURE_END
+
+int main(void)
+{
+	cbehave_feature features[] =
+	{
+		{feature_idx(1)}
+	};
+	
+	return cbehave_runner("Blit SIMD features are:", features);
+}
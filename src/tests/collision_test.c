@@ -0,0 +1,447 @@
+#include <cbehave/cbehave.h>
+
+#include <collision.h>
+#include <map.h>
+#include <tile_item_index.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FULL_W (TILE_WIDTH * 256)
+#define FULL_H (TILE_HEIGHT * 256)
+
+// An empty map with walls around its edge, and no items
+static void ResetMap(void)
+{
+	int i;
+	memset(gMap, 0, sizeof gMap);
+	for (i = 0; i < XMAX; i++)
+	{
+		Map(i, 0).flags = Map(i, YMAX - 1).flags = MAPTILE_NO_WALK;
+	}
+	for (i = 0; i < YMAX; i++)
+	{
+		Map(0, i).flags = Map(XMAX - 1, i).flags = MAPTILE_NO_WALK;
+	}
+	MapBitsInit();
+	TileItemIndexClear();
+}
+
+static void InitItem(TTileItem *t, int w, int h)
+{
+	memset(t, 0, sizeof *t);
+	t->w = w;
+	t->h = h;
+	t->kind = KIND_OBJECT;
+	t->flags = TILEITEM_CAN_BE_SHOT;
+}
+
+// A mover at a full coordinate position, not in the index
+static void InitMover(TTileItem *t, Vec2i pos)
+{
+	memset(t, 0, sizeof *t);
+	t->w = t->h = 1;
+	t->kind = KIND_MOBILEOBJECT;
+	t->x = pos.x / 256;
+	t->y = pos.y / 256;
+}
+
+// The full coordinate centre of a tile
+static Vec2i TileCentre(int x, int y)
+{
+	return Vec2iNew(x * FULL_W + FULL_W / 2, y * FULL_H + FULL_H / 2);
+}
+
+static CollisionSweep SweepShot(TTileItem *mover, Vec2i from, Vec2i to)
+{
+	return SweepForCollision(
+		mover, from, to, TILEITEM_CAN_BE_SHOT, COLLISIONTEAM_NONE, NULL, NULL);
+}
+
+
+#define BATCH_ITEMS 1500
+#define BATCH_SWEEPS 300
+
+static TTileItem sItems[BATCH_ITEMS];
+static TTileItem sMovers[BATCH_SWEEPS];
+static Vec2i sFroms[BATCH_SWEEPS];
+static Vec2i sTos[BATCH_SWEEPS];
+static int sIndices[BATCH_SWEEPS];
+
+// A map with random walls and random shootable items, some of them
+// overlapping each other
+static void RandomMap(void)
+{
+	int i;
+	ResetMap();
+	for (i = 0; i < 1000; i++)
+	{
+		Map(1 + rand() % (XMAX - 2), 1 + rand() % (YMAX - 2)).flags =
+			MAPTILE_NO_WALK;
+	}
+	MapBitsInit();
+	for (i = 0; i < BATCH_ITEMS; i++)
+	{
+		InitItem(&sItems[i], 1 + rand() % 7, 1 + rand() % 5);
+		MoveTileItem(
+			&sItems[i],
+			TILE_WIDTH + rand() % ((XMAX - 2) * TILE_WIDTH),
+			TILE_HEIGHT + rand() % ((YMAX - 2) * TILE_HEIGHT));
+	}
+}
+
+// Add random moves, most of them around one spot as with an explosion,
+// to a new batch
+static void AddRandomSweeps(void)
+{
+	const Vec2i c = TileCentre(
+		4 + rand() % (XMAX - 8), 4 + rand() % (YMAX - 8));
+	int i;
+	CollisionBatchBegin();
+	for (i = 0; i < BATCH_SWEEPS; i++)
+	{
+		if (i % 4 == 0)
+		{
+			sFroms[i] = TileCentre(
+				1 + rand() % (XMAX - 2), 1 + rand() % (YMAX - 2));
+		}
+		else
+		{
+			sFroms[i] = Vec2iNew(
+				c.x + rand() % 8000 - 4000, c.y + rand() % 8000 - 4000);
+		}
+		sTos[i] = Vec2iNew(
+			sFroms[i].x + rand() % 3000 - 1500,
+			sFroms[i].y + rand() % 3000 - 1500);
+		InitMover(&sMovers[i], sFroms[i]);
+		sIndices[i] = CollisionBatchAdd(
+			&sMovers[i], sFroms[i], sTos[i], TILEITEM_CAN_BE_SHOT);
+	}
+	CollisionBatchFindCandidates();
+}
+
+// Whether the batched and unbatched tests of a sweep agree
+static int IsSweepSameAsUnbatched(int i)
+{
+	const Vec2i pos = Vec2iScaleDiv(sTos[i], 256);
+	const CollisionSweep a = CollisionBatchSweep(
+		sIndices[i], &sMovers[i], sFroms[i], sTos[i], TILEITEM_CAN_BE_SHOT,
+		COLLISIONTEAM_NONE, NULL, NULL);
+	const CollisionSweep b = SweepShot(&sMovers[i], sFroms[i], sTos[i]);
+	return
+		a.item == b.item && a.isWall == b.isWall &&
+		a.pos.x == b.pos.x && a.pos.y == b.pos.y &&
+		CollisionBatchGetItem(
+			sIndices[i], &sMovers[i], pos, TILEITEM_CAN_BE_SHOT,
+			COLLISIONTEAM_NONE) ==
+		GetItemOnTileInCollision(
+			&sMovers[i], pos, TILEITEM_CAN_BE_SHOT, COLLISIONTEAM_NONE);
+}
+
+
+FEATURE(1, "Sweep")
+	SCENARIO("Stop short of a wall")
+	{
+		TTileItem mover;
+		Vec2i from, to;
+		CollisionSweep r;
+		GIVEN("a wall in the way of a move")
+			ResetMap();
+			Map(10, 5).flags = MAPTILE_NO_WALK;
+			MapBitsInit();
+			from = TileCentre(5, 5);
+			to = TileCentre(15, 5);
+			InitMover(&mover, from);
+		GIVEN_END
+
+		WHEN("I sweep the move")
+			r = SweepShot(&mover, from, to);
+		WHEN_END
+
+		THEN("it should hit the wall, one unit short of it");
+			SHOULD_INT_EQUAL(r.isWall, 1);
+			SHOULD_PTR_NULL(r.item);
+			SHOULD_INT_EQUAL(r.pos.x, 10 * FULL_W - 1);
+			SHOULD_INT_EQUAL(r.pos.y, from.y);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Hit an item before a wall")
+	{
+		TTileItem mover, item;
+		Vec2i from, to;
+		CollisionSweep r;
+		GIVEN("an item in front of a wall in the way of a move")
+			ResetMap();
+			Map(10, 5).flags = MAPTILE_NO_WALK;
+			MapBitsInit();
+			InitItem(&item, 4, 4);
+			MoveTileItem(
+				&item, 8 * TILE_WIDTH + TILE_WIDTH / 2,
+				5 * TILE_HEIGHT + TILE_HEIGHT / 2);
+			from = TileCentre(5, 5);
+			to = TileCentre(15, 5);
+			InitMover(&mover, from);
+		GIVEN_END
+
+		WHEN("I sweep the move")
+			r = SweepShot(&mover, from, to);
+		WHEN_END
+
+		THEN("it should hit the item, where it first touches it");
+			SHOULD_PTR_EQUAL(r.item, &item);
+			SHOULD_INT_EQUAL(r.isWall, 0);
+			SHOULD_INT_EQUAL(r.pos.x / 256, item.x - item.w - mover.w + 1);
+			SHOULD_INT_EQUAL(r.pos.y, from.y);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Leave an item the mover starts inside")
+	{
+		TTileItem mover, item;
+		Vec2i from, away, into;
+		CollisionSweep rAway, rInto;
+		GIVEN("a mover inside an item")
+			ResetMap();
+			InitItem(&item, 4, 4);
+			MoveTileItem(
+				&item, 8 * TILE_WIDTH + TILE_WIDTH / 2,
+				5 * TILE_HEIGHT + TILE_HEIGHT / 2);
+			from = Vec2iNew((item.x + 2) * 256, (item.y + 2) * 256);
+			away = Vec2iNew(from.x + 10 * 256, from.y + 10 * 256);
+			into = Vec2iNew(item.x * 256, item.y * 256);
+			InitMover(&mover, from);
+		GIVEN_END
+
+		WHEN("I sweep moves out of and into the item")
+			rAway = SweepShot(&mover, from, away);
+			rInto = SweepShot(&mover, from, into);
+		WHEN_END
+
+		THEN("only the move further into the item should hit it");
+			SHOULD_PTR_NULL(rAway.item);
+			SHOULD_INT_EQUAL(rAway.isWall, 0);
+			SHOULD_INT_EQUAL(rAway.pos.x, away.x);
+			SHOULD_INT_EQUAL(rAway.pos.y, away.y);
+			SHOULD_PTR_EQUAL(rInto.item, &item);
+			SHOULD_INT_EQUAL(rInto.pos.x, from.x);
+			SHOULD_INT_EQUAL(rInto.pos.y, from.y);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Zero length moves")
+	{
+		TTileItem mover, item;
+		Vec2i open, inside;
+		CollisionSweep rOpen, rInside;
+		TTileItem *expected;
+		GIVEN("a position in the open and one inside an item")
+			ResetMap();
+			InitItem(&item, 4, 4);
+			MoveTileItem(
+				&item, 8 * TILE_WIDTH + TILE_WIDTH / 2,
+				5 * TILE_HEIGHT + TILE_HEIGHT / 2);
+			open = TileCentre(3, 3);
+			inside = Vec2iNew((item.x + 1) * 256, (item.y + 1) * 256);
+		GIVEN_END
+
+		WHEN("I sweep moves that stay where they are")
+			InitMover(&mover, open);
+			rOpen = SweepShot(&mover, open, open);
+			InitMover(&mover, inside);
+			rInside = SweepShot(&mover, inside, inside);
+			expected = GetItemOnTileInCollision(
+				&mover, Vec2iScaleDiv(inside, 256),
+				TILEITEM_CAN_BE_SHOT, COLLISIONTEAM_NONE);
+		WHEN_END
+
+		THEN("they should hit what is at the position, and not move");
+			SHOULD_PTR_NULL(rOpen.item);
+			SHOULD_INT_EQUAL(rOpen.isWall, 0);
+			SHOULD_INT_EQUAL(rOpen.pos.x, open.x);
+			SHOULD_INT_EQUAL(rOpen.pos.y, open.y);
+			SHOULD_PTR_EQUAL(rInside.item, &item);
+			SHOULD_PTR_EQUAL(rInside.item, expected);
+			SHOULD_INT_EQUAL(rInside.pos.x, inside.x);
+			SHOULD_INT_EQUAL(rInside.pos.y, inside.y);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Move along the edge of the map")
+	{
+		TTileItem mover;
+		Vec2i from, along, off;
+		CollisionSweep rAlong, rOff;
+		GIVEN("a position right next to the wall around the map")
+			ResetMap();
+			from = Vec2iNew(FULL_W, FULL_H);
+			along = Vec2iNew((XMAX - 1) * FULL_W - 1, FULL_H);
+			off = Vec2iNew((XMAX + 5) * FULL_W, FULL_H);
+			InitMover(&mover, from);
+		GIVEN_END
+
+		WHEN("I sweep moves along the wall, and off the map")
+			rAlong = SweepShot(&mover, from, along);
+			rOff = SweepShot(&mover, from, off);
+		WHEN_END
+
+		THEN("the move along the wall should not hit it");
+			SHOULD_INT_EQUAL(rAlong.isWall, 0);
+			SHOULD_INT_EQUAL(rAlong.pos.x, along.x);
+			SHOULD_INT_EQUAL(rAlong.pos.y, along.y);
+		THEN_END
+
+		THEN("the move off the map should stop at the wall at its end");
+			SHOULD_INT_EQUAL(rOff.isWall, 1);
+			SHOULD_INT_EQUAL(rOff.pos.x, (XMAX - 1) * FULL_W - 1);
+			SHOULD_INT_EQUAL(rOff.pos.y, from.y);
+		THEN_END
+	}
+	SCENARIO_END
+FEATURE_END
+
+FEATURE(2, "Batched sweeps")
+	SCENARIO("Batched sweeps find what unbatched sweeps find")
+	{
+		int mismatches = 0;
+		int i;
+		GIVEN("a map with random walls and items")
+			srand(1);
+			RandomMap();
+		GIVEN_END
+
+		WHEN("I make random sweeps in a batch")
+			AddRandomSweeps();
+			for (i = 0; i < BATCH_SWEEPS; i++)
+			{
+				mismatches += !IsSweepSameAsUnbatched(i);
+			}
+			CollisionBatchEnd();
+		WHEN_END
+
+		THEN("the sweeps and point tests should find the same things");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Find the same item where items overlap")
+	{
+		TTileItem mover, below, above;
+		Vec2i pos;
+		int index;
+		TTileItem *batched, *unbatched;
+		GIVEN("two overlapping items, on tiles one above the other")
+			ResetMap();
+			// The lower item is added first, and starts further left, so
+			// the batch finds it first
+			InitItem(&below, 8, 4);
+			MoveTileItem(&below, 8 * TILE_WIDTH + 4, 6 * TILE_HEIGHT + 1);
+			InitItem(&above, 4, 4);
+			MoveTileItem(&above, 8 * TILE_WIDTH + 4, 6 * TILE_HEIGHT - 1);
+			pos = Vec2iNew(8 * TILE_WIDTH + 4, 6 * TILE_HEIGHT);
+			InitMover(&mover, Vec2iScale(pos, 256));
+		GIVEN_END
+
+		WHEN("I test the point where they overlap, batched and unbatched")
+			CollisionBatchBegin();
+			index = CollisionBatchAdd(
+				&mover, Vec2iScale(pos, 256), Vec2iScale(pos, 256),
+				TILEITEM_CAN_BE_SHOT);
+			CollisionBatchFindCandidates();
+			batched = CollisionBatchGetItem(
+				index, &mover, pos, TILEITEM_CAN_BE_SHOT, COLLISIONTEAM_NONE);
+			CollisionBatchEnd();
+			unbatched = GetItemOnTileInCollision(
+				&mover, pos, TILEITEM_CAN_BE_SHOT, COLLISIONTEAM_NONE);
+		WHEN_END
+
+		THEN("both should find the item on the upper tile");
+			SHOULD_PTR_EQUAL(unbatched, &above);
+			SHOULD_PTR_EQUAL(batched, &above);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Remove items in the middle of a batch")
+	{
+		int mismatches = 0;
+		int i;
+		GIVEN("a batch of random sweeps")
+			srand(2);
+			RandomMap();
+			AddRandomSweeps();
+		GIVEN_END
+
+		WHEN("I remove items between the sweeps, as damage does")
+			for (i = 0; i < BATCH_SWEEPS; i++)
+			{
+				const CollisionSweep r = SweepShot(
+					&sMovers[i], sFroms[i], sTos[i]);
+				if (i % 2 == 0 && r.item != NULL)
+				{
+					RemoveTileItem(r.item);
+				}
+				mismatches += !IsSweepSameAsUnbatched(i);
+			}
+			CollisionBatchEnd();
+		WHEN_END
+
+		THEN("the sweeps should not hit the removed items");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Move items in the middle of a batch")
+	{
+		TTileItem moved[BATCH_SWEEPS];
+		int mismatches = 0;
+		int i;
+		GIVEN("a batch of random sweeps")
+			srand(3);
+			RandomMap();
+			AddRandomSweeps();
+		GIVEN_END
+
+		WHEN("I add items in the way of the sweeps between them")
+			for (i = 0; i < BATCH_SWEEPS; i++)
+			{
+				if (i % 3 == 0)
+				{
+					InitItem(&moved[i], 4, 3);
+					MoveTileItem(
+						&moved[i],
+						(sFroms[i].x + sTos[i].x) / 512,
+						(sFroms[i].y + sTos[i].y) / 512);
+				}
+				mismatches += !IsSweepSameAsUnbatched(i);
+			}
+			CollisionBatchEnd();
+			for (i = 0; i < BATCH_SWEEPS; i += 3)
+			{
+				RemoveTileItem(&moved[i]);
+			}
+		WHEN_END
+
+		THEN("the sweeps should fall back to finding the new items");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+FEATURE_END
+
+int main(void)
+{
+	cbehave_feature features[] =
+	{
+		{feature_idx(1)},
+		{feature_idx(2)}
+	};
+
+	return cbehave_runner("Collision features are:", features);
+}
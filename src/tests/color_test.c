@@ -3,6 +3,10 @@
 #include <color.h>
 
 #include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils.h>
 
 
 FEATURE(1, "Multiply")
@@ -243,13 +247,217 @@ FEATURE(3, "Tint")
 	SCENARIO_END
 FEATURE_END
 
+FEATURE(4, "Pixel format")
+	SCENARIO("Convert a color to a pixel and back")
+	{
+		color_t c, result;
+		uint32_t pixel;
+		GIVEN("a color")
+			c.r = 123;
+			c.g = 234;
+			c.b = 45;
+			c.a = 255;
+		GIVEN_END
+
+		WHEN("I convert it to a pixel and back")
+			pixel = PixelFromColor(c);
+			result = PixelToColor(pixel);
+		WHEN_END
+
+		THEN("the pixel should be ARGB8888 and the color should be the same");
+			SHOULD_INT_EQUAL(pixel, 0x007BEA2D);
+			SHOULD_MEM_EQUAL(&result, &c, sizeof result);
+		THEN_END
+	}
+	SCENARIO_END
+FEATURE_END
+
+// The game's tints, and some other hues, saturations and values
+static HSV sTints[] =
+{
+	{ 0.0, 1.0, 1.0 },
+	{ 120.0, 1.0, 1.0 },
+	{ 120.0, 0.33, 2.0 },
+	{ -1.0, 0.0, 1.0 },
+	{ 300, 1.0, 1.0 },
+	{ -1.0, 1.0, 0.75 },
+	{ -1.0, 1.0, 0.0 },
+	{ -1.0, 1.0, 0.37 },
+	{ -1.0, 0.5, 1.5 },
+	{ 50.0, 1.0, 1.0 },
+	{ 120.0, 1.0, 0.5 },
+	{ 200.0, 0.6, 0.8 },
+	{ 359.9, 0.7, 0.5 }
+};
+#define TINT_COUNT ((int)(sizeof sTints / sizeof sTints[0]))
+
+// Largest difference of a component between ColorTint and ColorTintFixed,
+// over a spread of colors
+static int GetMaxTintFixedError(HSV hsv)
+{
+	TintFixed t;
+	int maxError = 0;
+	int r, g, b;
+	TintFixedInit(&t, hsv);
+	for (r = 0; r < 256; r += 5)
+	{
+		for (g = 0; g < 256; g += 3)
+		{
+			for (b = 0; b < 256; b++)
+			{
+				color_t c, expected, actual;
+				c.r = (uint8_t)r;
+				c.g = (uint8_t)g;
+				c.b = (uint8_t)b;
+				c.a = 255;
+				expected = ColorTint(c, hsv);
+				actual = ColorTintFixed(c, &t);
+				maxError = MAX(maxError, abs(expected.r - actual.r));
+				maxError = MAX(maxError, abs(expected.g - actual.g));
+				maxError = MAX(maxError, abs(expected.b - actual.b));
+			}
+		}
+	}
+	return maxError;
+}
+
+// Number of colors for which the tint LUT differs from ColorTintFixed
+static int CountTintLUTMismatches(HSV hsv)
+{
+	static TintLUT lut;
+	TintFixed t;
+	int mismatches = 0;
+	int r, g, b;
+	TintFixedInit(&t, hsv);
+	TintLUTInit(&lut, hsv);
+	for (r = 0; r < 256; r += 5)
+	{
+		for (g = 0; g < 256; g += 3)
+		{
+			for (b = 0; b < 256; b++)
+			{
+				color_t c;
+				c.r = (uint8_t)r;
+				c.g = (uint8_t)g;
+				c.b = (uint8_t)b;
+				c.a = 255;
+				mismatches +=
+					TintLUTPixel(&lut, PixelFromColor(c)) !=
+					PixelFromColor(ColorTintFixed(c, &t));
+			}
+		}
+	}
+	return mismatches;
+}
+
+FEATURE(5, "Fixed point tint")
+	SCENARIO("Fixed point tint is close to the tint")
+	{
+		int maxError = 0;
+		int i;
+		GIVEN("tints")
+		GIVEN_END
+
+		WHEN("I tint colors with fixed point math")
+			for (i = 0; i < TINT_COUNT; i++)
+			{
+				maxError = MAX(maxError, GetMaxTintFixedError(sTints[i]));
+			}
+		WHEN_END
+
+		THEN("the results should be within 1 of the tint");
+			SHOULD_INT_LE(maxError, 1);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Tint to white (max value) in fixed point")
+	{
+		color_t c;
+		HSV hsv;
+		TintFixed t;
+		GIVEN("a color")
+			c.r = 123;
+			c.g = 234;
+			c.b = 45;
+		GIVEN_END
+
+		WHEN("I tint it with max value and no hue")
+			hsv.h = -1.0;
+			hsv.s = 1.0;
+			hsv.v = DBL_MAX;
+			TintFixedInit(&t, hsv);
+			c = ColorTintFixed(c, &t);
+		WHEN_END
+
+		THEN("the result should be white");
+			SHOULD_INT_EQUAL(c.r, 255);
+			SHOULD_INT_EQUAL(c.g, 255);
+			SHOULD_INT_EQUAL(c.b, 255);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Tint with lookup tables")
+	{
+		int mismatches = 0;
+		int i;
+		GIVEN("tints")
+		GIVEN_END
+
+		WHEN("I tint pixels with the tints' lookup tables")
+			for (i = 0; i < TINT_COUNT; i++)
+			{
+				mismatches += CountTintLUTMismatches(sTints[i]);
+			}
+		WHEN_END
+
+		THEN("the results should be the same as the fixed point tint");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Change the value of a fixed point tint")
+	{
+		int mismatches = 0;
+		int i, j;
+		GIVEN("tints")
+		GIVEN_END
+
+		WHEN("I change their values")
+			for (i = 0; i < TINT_COUNT; i++)
+			{
+				for (j = 0; j <= 20; j++)
+				{
+					HSV hsv = sTints[i];
+					TintFixed changed, made;
+					TintFixedInit(&changed, hsv);
+					hsv.v = j * 0.1;
+					TintFixedSetValue(&changed, hsv);
+					TintFixedInit(&made, hsv);
+					mismatches +=
+						memcmp(&changed, &made, sizeof changed) != 0;
+				}
+			}
+		WHEN_END
+
+		THEN("they should be the same as tints made with those values");
+			SHOULD_INT_EQUAL(mismatches, 0);
+		THEN_END
+	}
+	SCENARIO_END
+FEATURE_END
+
 int main(void)
 {
 	cbehave_feature features[] =
 	{
 		{feature_idx(1)},
 		{feature_idx(2)},
-		{feature_idx(3)}
+		{feature_idx(3)},
+		{feature_idx(4)},
+		{feature_idx(5)}
 	};
 	
 	return cbehave_runner("Color features are:", features);
@@ -0,0 +1,207 @@
+#include <cbehave/cbehave.h>
+
+#include <map.h>
+#include <tile_item_index.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ITEM_COUNT 2000
+
+static TTileItem sItems[ITEM_COUNT];
+// Whether each item should be in the index
+static int sIsAdded[ITEM_COUNT];
+
+static void InitItems(void)
+{
+	int i;
+	TileItemIndexClear();
+	memset(sItems, 0, sizeof sItems);
+	memset(sIsAdded, 0, sizeof sIsAdded);
+	for (i = 0; i < ITEM_COUNT; i++)
+	{
+		sItems[i].w = 1 + i % 8;
+		sItems[i].h = 1 + i % 6;
+		sItems[i].kind = KIND_OBJECT;
+		sItems[i].flags = TILEITEM_CAN_BE_SHOT;
+	}
+}
+
+static void Add(int i, int x, int y)
+{
+	MoveTileItem(&sItems[i], x, y);
+	sIsAdded[i] = 1;
+}
+
+static void Remove(int i)
+{
+	RemoveTileItem(&sItems[i]);
+	sIsAdded[i] = 0;
+}
+
+// Count the ways in which the items' cells and slots disagree with the
+// cells' entries
+static int CountInconsistencies(void)
+{
+	int count = 0;
+	int entries = 0;
+	int added = 0;
+	int x, y, i;
+	for (y = 0; y < YMAX; y++)
+	{
+		for (x = 0; x < XMAX; x++)
+		{
+			const TileItemCell *cell = TileItemIndexGetCell(x, y);
+			for (i = 0; i < cell->count; i++)
+			{
+				const TileItemEntry *e = &cell->entries[i];
+				const TTileItem *t = e->item;
+				entries++;
+				count +=
+					t->cell != cell || t->slot != i ||
+					t->x / TILE_WIDTH != x || t->y / TILE_HEIGHT != y ||
+					e->x != t->x || e->y != t->y ||
+					e->w != t->w || e->h != t->h ||
+					e->flags != t->flags || !sIsAdded[t - sItems];
+			}
+		}
+	}
+	for (i = 0; i < ITEM_COUNT; i++)
+	{
+		const TileItemEntry *e = TileItemIndexGetEntry(&sItems[i]);
+		added += sIsAdded[i];
+		count += sIsAdded[i] ?
+			e == NULL || e->item != &sItems[i] : e != NULL;
+	}
+	return count + (entries != added);
+}
+
+
+FEATURE(1, "Tile item index")
+	SCENARIO("Add items to a tile")
+	{
+		int inconsistencies;
+		GIVEN("an empty index")
+			InitItems();
+		GIVEN_END
+
+		WHEN("I add items to the same tile")
+			Add(0, 5 * TILE_WIDTH, 5 * TILE_HEIGHT);
+			Add(1, 5 * TILE_WIDTH + 1, 5 * TILE_HEIGHT + 1);
+			Add(2, 5 * TILE_WIDTH + 2, 5 * TILE_HEIGHT + 2);
+			inconsistencies = CountInconsistencies();
+		WHEN_END
+
+		THEN("they should be in the tile's cell, in the order added");
+			SHOULD_INT_EQUAL(inconsistencies, 0);
+			SHOULD_INT_EQUAL(TileItemIndexGetCell(5, 5)->count, 3);
+			SHOULD_INT_EQUAL(sItems[0].slot, 0);
+			SHOULD_INT_EQUAL(sItems[1].slot, 1);
+			SHOULD_INT_EQUAL(sItems[2].slot, 2);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Remove an item from a tile")
+	{
+		int inconsistencies;
+		GIVEN("a tile with three items")
+			InitItems();
+			Add(0, 5 * TILE_WIDTH, 5 * TILE_HEIGHT);
+			Add(1, 5 * TILE_WIDTH + 1, 5 * TILE_HEIGHT + 1);
+			Add(2, 5 * TILE_WIDTH + 2, 5 * TILE_HEIGHT + 2);
+		GIVEN_END
+
+		WHEN("I remove the first item")
+			Remove(0);
+			inconsistencies = CountInconsistencies();
+		WHEN_END
+
+		THEN("the last item should take its slot");
+			SHOULD_INT_EQUAL(inconsistencies, 0);
+			SHOULD_INT_EQUAL(TileItemIndexGetCell(5, 5)->count, 2);
+			SHOULD_INT_EQUAL(sItems[2].slot, 0);
+			SHOULD_INT_EQUAL(sItems[1].slot, 1);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Move items within and between tiles")
+	{
+		int inconsistencies;
+		GIVEN("a tile with three items")
+			InitItems();
+			Add(0, 5 * TILE_WIDTH, 5 * TILE_HEIGHT);
+			Add(1, 5 * TILE_WIDTH + 1, 5 * TILE_HEIGHT + 1);
+			Add(2, 5 * TILE_WIDTH + 2, 5 * TILE_HEIGHT + 2);
+		GIVEN_END
+
+		WHEN("I move one item within the tile and one to another tile")
+			MoveTileItem(&sItems[1], 5 * TILE_WIDTH + 3, 5 * TILE_HEIGHT + 3);
+			MoveTileItem(&sItems[0], 6 * TILE_WIDTH, 5 * TILE_HEIGHT);
+			inconsistencies = CountInconsistencies();
+		WHEN_END
+
+		THEN("their entries should be in the cells of their new tiles");
+			SHOULD_INT_EQUAL(inconsistencies, 0);
+			SHOULD_INT_EQUAL(TileItemIndexGetCell(5, 5)->count, 2);
+			SHOULD_INT_EQUAL(TileItemIndexGetCell(6, 5)->count, 1);
+			SHOULD_INT_EQUAL(sItems[1].slot, 1);
+		THEN_END
+	}
+	SCENARIO_END
+
+	SCENARIO("Add, remove, move and update items at random")
+	{
+		int inconsistencies = 0;
+		int step;
+		GIVEN("an empty index")
+			InitItems();
+			srand(1);
+		GIVEN_END
+
+		WHEN("I change items at random")
+			for (step = 0; step < 100000; step++)
+			{
+				const int i = rand() % ITEM_COUNT;
+				switch (rand() % 4)
+				{
+				case 0:
+				case 1:
+					Add(
+						i,
+						rand() % (XMAX * TILE_WIDTH),
+						rand() % (YMAX * TILE_HEIGHT));
+					break;
+				case 2:
+					Remove(i);
+					break;
+				default:
+					sItems[i].flags = rand() % 4;
+					TileItemIndexUpdate(&sItems[i]);
+					break;
+				}
+				if (step % 1000 == 0)
+				{
+					inconsistencies += CountInconsistencies();
+				}
+			}
+			inconsistencies += CountInconsistencies();
+		WHEN_END
+
+		THEN("the items' cells and slots should match the cells' entries");
+			SHOULD_INT_EQUAL(inconsistencies, 0);
+		THEN_END
+	}
+	SCENARIO_END
+FEATURE_END
+
+int main(void)
+{
+	cbehave_feature features[] =
+	{
+		{feature_idx(1)}
+	};
+
+	return cbehave_runner("Tile item index features are:", features);
+}